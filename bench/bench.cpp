@@ -0,0 +1,369 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <experimental/filesystem>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+#include "graph.h"
+#include "pmaxcut.h"
+#include "generator.h"
+#include "incremental.h"
+
+namespace fs = std::experimental::filesystem;
+using namespace std;
+
+/* Benchmarks of each stage of the experiments : parsing, conversion, generation and cut solving,
+ * on the test folders and on synthetic size ladders.
+ *
+ * Each benchmark runs once to warm up, then reps times. The results are written as JSON :
+ * median and 95th percentile of the time, allocations per run, vertices and edges per second
+ * (of the input of the stage).
+ *
+ * Usage : bench [--reps N] [--quick] [--out FILE]
+ * --quick runs each benchmark 3 times and stops the ladders early.
+ */
+
+/********************* Allocation counting *********************************/
+
+static atomic<uint64_t> n_allocations(0);
+
+void* operator new(size_t size)
+{
+	n_allocations.fetch_add(1, memory_order_relaxed);
+	void *p = malloc(size ? size : 1);
+	if (p == nullptr) throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+
+/********************* Benchmarks *********************************/
+
+struct BenchResult
+{
+	string name;
+	string input;
+	long n, m;				// size of the input of the stage
+	vector<double> times;	// seconds, one per run
+	uint64_t allocations;	// per run
+};
+
+static int reps = 10;
+static bool quick = false;
+static vector<BenchResult> results;
+
+static double percentile(vector<double> values, double q)
+{
+	sort(values.begin(), values.end());
+	size_t k = min(values.size() - 1, (size_t)(q * (values.size() - 1) + 0.5));
+	return values[k];
+}
+
+/* Runs one benchmark
+ *
+ * @param name 	Stage
+ * @param input Input of the stage (folder or synthetic instance)
+ * @param n, m 	Number of vertices and edges of the input
+ * @param run 	One run of the stage
+ */
+static void bench(const string &name, const string &input, long n, long m, const function<void()> &run)
+{
+	run(); // warm up
+
+	BenchResult res;
+	res.name = name;
+	res.input = input;
+	res.n = n;
+	res.m = m;
+	uint64_t allocations = n_allocations.load();
+	for (int r = 0; r < reps; ++r)
+	{
+		auto start = chrono::steady_clock::now();
+		run();
+		res.times.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+	}
+	res.allocations = (n_allocations.load() - allocations) / reps;
+	results.push_back(res);
+
+	cerr << name << " " << input << " : " << percentile(res.times, 0.5) << " s" << endl;
+}
+
+static string json_string(const string &s)
+{
+	stringstream res;
+	res << '"';
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+			res << '\\';
+		res << c;
+	}
+	res << '"';
+	return res.str();
+}
+
+static void write_json(ostream &out)
+{
+	out << "[\n";
+	for (size_t k = 0; k < results.size(); ++k)
+	{
+		const BenchResult &r = results[k];
+		double median = percentile(r.times, 0.5);
+		out << "  {\"name\": " << json_string(r.name)
+			<< ", \"input\": " << json_string(r.input)
+			<< ", \"vertices\": " << r.n
+			<< ", \"edges\": " << r.m
+			<< ", \"runs\": " << r.times.size()
+			<< setprecision(6)
+			<< ", \"median_s\": " << median
+			<< ", \"p95_s\": " << percentile(r.times, 0.95)
+			<< ", \"allocations\": " << r.allocations
+			<< ", \"vertices_per_s\": " << ((median > 0) ? r.n / median : 0)
+			<< ", \"edges_per_s\": " << ((median > 0) ? r.m / median : 0)
+			<< "}" << ((k + 1 < results.size()) ? "," : "") << "\n";
+	}
+	out << "]" << endl;
+}
+
+static vector<string> folder_files(const string &folder)
+{
+	vector<string> files;
+	for (const auto &entry : fs::directory_iterator(folder))
+	{
+		string path = entry.path().string();
+		if (path.find(".pmc") == string::npos)
+			files.push_back(path);
+	}
+	sort(files.begin(), files.end());
+	return files;
+}
+
+// Stages on the graphs of a folder : n and m are summed over the files
+static void bench_folder(const string &folder, bool convert)
+{
+	vector<string> files = folder_files(folder);
+	vector<Graph> raw, graphs;
+	long n_raw = 0, m_raw = 0, n = 0, m = 0;
+	for (auto &file : files)
+	{
+		if (convert)
+		{
+			raw.push_back(read_graph_from_file(file, "", "size", ""));
+			n_raw += raw.back().n_vertices();
+			m_raw += raw.back().n_edges();
+			graphs.push_back(convert_to_SimpleDataFlow(raw.back()));
+		}
+		else
+		{
+			graphs.push_back(read_graph_from_pegasus(file));
+		}
+		n += graphs.back().n_vertices();
+		m += graphs.back().n_edges();
+	}
+
+	if (convert)
+	{
+		bench("read_graph_from_file", folder, n_raw, m_raw, [&]()
+		{
+			for (auto &file : files)
+				read_graph_from_file(file, "", "size", "");
+		});
+		bench("convert_to_SimpleDataFlow", folder, n_raw, m_raw, [&]()
+		{
+			for (auto &g : raw)
+				convert_to_SimpleDataFlow(g);
+		});
+	}
+	else
+	{
+		bench("read_graph_from_pegasus", folder, n, m, [&]()
+		{
+			for (auto &file : files)
+				read_graph_from_pegasus(file);
+		});
+	}
+
+	vector<int> cut, S, T;
+	double value;
+	bench("get_maxcut_flow", folder, n, m, [&]()
+	{
+		for (auto &g : graphs)
+			get_maxcut_flow(g, cut, S, T, value);
+	});
+	bench("get_maxcut_lin", folder, n, m, [&]()
+	{
+		for (auto &g : graphs)
+			get_maxcut_lin(g, cut, S, T, value);
+	});
+	bench("get_p_maxcut_lin LP p=3", folder, n, m, [&]()
+	{
+		for (auto &g : graphs)
+			get_p_maxcut_lin(g, 3, cut, S, T, value);
+	});
+	bench("get_p_maxcut_lin ILP p=3", folder, n, m, [&]()
+	{
+		for (auto &g : graphs)
+			get_p_maxcut_lin(g, 3, cut, S, T, value, true);
+	});
+#ifdef WITH_GUROBI
+	// Without Gurobi, the flow backend is the default one
+	set_solver_backend("flow");
+	bench("get_p_maxcut_lin LP p=3 flow", folder, n, m, [&]()
+	{
+		for (auto &g : graphs)
+			get_p_maxcut_lin(g, 3, cut, S, T, value);
+	});
+	set_solver_backend("gurobi");
+#endif
+}
+
+// Stages on random DAGs of increasing size
+static void bench_ladder()
+{
+	DagWeights weights;
+	weights.w_max = 500;
+	weights.w_max_edges = 500;
+	int max_n = (quick) ? 10000 : 100000;
+
+	for (int n = 100; n <= 1000; n *= 10)
+	{
+		srandom(0);
+		Graph g = generate_dag_ss(n, 0.1, 500, 1, 500);
+		bench("generate_dag_ss", "p=0.1", n, g.n_edges(), [&]()
+		{
+			generate_dag_ss(n, 0.1, 500, 1, 500);
+		});
+	}
+
+	for (int n = 100; n <= max_n; n *= 10)
+	{
+		// About 4 edges per vertex before the conversion
+		double connectedness = min(1.0, 8.0 / n);
+		mt19937_64 rng(n);
+		Graph g = generate_random_dag(n, connectedness, weights, rng);
+		string input = "random n=" + to_string(n);
+		bench("generate_random_dag", input, g.n_vertices(), g.n_edges(), [&]()
+		{
+			mt19937_64 rng(n);
+			generate_random_dag(n, connectedness, weights, rng);
+		});
+
+		vector<int> cut, S, T;
+		double value;
+		bench("get_maxcut_flow", input, g.n_vertices(), g.n_edges(), [&]()
+		{
+			get_maxcut_flow(g, cut, S, T, value);
+		});
+		CSRGraph csr(g);
+		bench("get_maxcut_parallel", input, g.n_vertices(), g.n_edges(), [&]()
+		{
+			get_maxcut_parallel(csr, cut, S, T, value);
+		});
+		IncrementalMaxcut incremental(g);
+		mt19937_64 edits(n);
+		bench("IncrementalMaxcut::set_weight x100", input, g.n_vertices(), g.n_edges(), [&]()
+		{
+			for (int k = 0; k < 100; ++k)
+				incremental.set_weight(edits() % g.n_edges(), weights.w_max_edges * (edits() % 1000) / 1000);
+		});
+		bench("get_maxcut_lin", input, g.n_vertices(), g.n_edges(), [&]()
+		{
+			get_maxcut_lin(g, cut, S, T, value);
+		});
+		bench("get_p_maxcut_lin LP p=3", input, g.n_vertices(), g.n_edges(), [&]()
+		{
+			get_p_maxcut_lin(g, 3, cut, S, T, value);
+		});
+#ifdef WITH_GUROBI
+		set_solver_backend("flow");
+		bench("get_p_maxcut_lin LP p=3 flow", input, g.n_vertices(), g.n_edges(), [&]()
+		{
+			get_p_maxcut_lin(g, 3, cut, S, T, value);
+		});
+		set_solver_backend("gurobi");
+#endif
+		bench("get_p_maxcut_heuristic p=3", input, g.n_vertices(), g.n_edges(), [&]()
+		{
+			get_p_maxcut_heuristic(g, 3, cut, S, T, value);
+		});
+		if (n <= 1000) // the ILP is exponential in the worst case
+		{
+			bench("get_p_maxcut_lin ILP p=3", input, g.n_vertices(), g.n_edges(), [&]()
+			{
+				get_p_maxcut_lin(g, 3, cut, S, T, value, true);
+			});
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	string out_file;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "--reps" && i + 1 < argc)
+			reps = max(1, stoi(argv[++i]));
+		else if (arg == "--quick")
+			quick = true;
+		else if (arg == "--out" && i + 1 < argc)
+			out_file = argv[++i];
+		else
+		{
+			cerr << "Usage : " << argv[0] << " [--reps N] [--quick] [--out FILE]" << endl;
+			return 1;
+		}
+	}
+	if (quick)
+		reps = min(reps, 3);
+
+	// Solvers use one thread, for stable timings
+	set_solver_threads(1);
+
+	bench_folder("./tests/Pegasus/GENOME", false);
+	bench_folder("./tests/Pegasus/LIGO", false);
+	bench_folder("./tests/Pegasus/MONTAGE", false);
+	bench_folder("./tests/randomsets/completeset", true);
+	bench_folder("./tests/Pegasus/qr-mumps-trees", true);
+	bench_ladder();
+
+	if (out_file.empty())
+	{
+		write_json(cout);
+	}
+	else
+	{
+		ofstream out(out_file);
+		write_json(out);
+	}
+	return 0;
+}
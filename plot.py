@@ -18,7 +18,7 @@ def read_data(filename):
 			name = l.split(" ")[1].split("/")[-1]
 			p = l.split()[2]
 		else:
-			_, a,b,c = l.split()
+			_, a,b,c = l.split()[:4] # --stats adds columns after the values
 			x.append(float(a))
 			y.append(float(b))
 			z.append(float(c))
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "pmaxcut.h"
+#include "csr.h"
+#include <memory>
+#include <vector>
+
+/* Solvers of the p-maxcut LP of a graph, used by PMaxcutSession
+ *
+ * max sum_{(a,b)} w_ab (p_a - p_b) s.t. p_a >= p_b, p_source = 1, p_target = 0
+ * and proc_count = sum_{(a,b) red} (p_a - p_b) <= p_max
+ *
+ * A backend is built once per graph and then solves the LP (or the ILP, if it supports it)
+ * for any number of values of p.
+ */
+class CutBackend
+{
+public:
+	virtual ~CutBackend() {}
+
+	virtual bool supports_integral() const = 0;
+
+	/* @param p_max 		value of p
+	 * @param integral 		true to solve the ILP, only if supports_integral()
+	 * @param pi_values 	vector that will contain the value of the variable of each vertex
+	 * @param bound 		double where the value of the LP (or the bound of the ILP) will be stored
+	 * @param stats 		if not null, the iterations, nodes and gap are stored in it
+	 *
+	 * @return 0 if everything went well, 1 if there was an error in the solver, 2 if the LP is infeasible
+	 */
+	virtual int solve(int p_max, bool integral, std::vector<double> &pi_values, double &bound, SolverStats *stats) = 0;
+
+	/* Solves the ILP, knowing a feasible cut : only if supports_integral().
+	 * A backend may use the cut as a starting solution, and fix the variables that have the
+	 * same value in all the cuts at least as good as it. By default, the ILP is solved without it.
+	 *
+	 * @param start 		value of the variable of each vertex in the feasible cut
+	 * @param start_value 	weight of the feasible cut (-infinity if there is none, start is then ignored)
+	 * @param options 		if not null, the limits of the solve, and the callback of the improving cuts
+	 * 						and bounds (with the time since the start of this solve). At a limit, pi_values
+	 * 						is the best cut found (start if there is none), and bound the best bound.
+	 */
+	virtual int solve_integral(int p_max, const std::vector<double> & /*start*/, double /*start_value*/,
+			const AnytimeOptions * /*options*/, std::vector<double> &pi_values, double &bound, SolverStats *stats)
+	{
+		return solve(p_max, true, pi_values, bound, stats);
+	}
+};
+
+/* Backend without LP solver : each constraint p_a >= p_b is a difference constraint, so for a
+ * fixed multiplier lambda of the proc_count constraint the LP is a maximum weight closure,
+ * whose dual is a max-flow (see flowcut.cpp). lambda is searched by dichotomy between the cuts
+ * with at most / more than p_max red edges, and the LP solution is the convex combination of
+ * the two cuts around p_max.
+ * The cuts found are kept : the following solves start from the closest ones.
+ */
+class FlowBackend : public CutBackend
+{
+private:
+	CSRGraph graph;
+	double total;	// total absolute weight
+	double tol;
+	std::vector<double> weights;
+	std::vector<PMaxcutBreakpoint> known;	// cuts found, by increasing number of red edges
+	int evaluations;
+
+	const PMaxcutBreakpoint& evaluate(double lambda);
+
+public:
+	FlowBackend(const Graph &graph);
+
+	int bracket(int p_max, PMaxcutBreakpoint &a, PMaxcutBreakpoint &b, double &bound);
+
+	bool supports_integral() const { return false; }
+	int solve(int p_max, bool integral, std::vector<double> &pi_values, double &bound, SolverStats *stats);
+};
+
+#ifdef WITH_GUROBI
+std::unique_ptr<CutBackend> make_gurobi_backend(const Graph &graph, int n_threads);
+#endif
@@ -0,0 +1,126 @@
+#include "cache.h"
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/* This file contains the binary cache of graphs
+ */
+
+static bool source_stat(const string &source_file, int64_t &size, int64_t &mtime)
+{
+	struct stat st;
+	if (stat(source_file.c_str(), &st) < 0) return false;
+	size = st.st_size;
+	mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	return true;
+}
+
+/* @param source_file 	File the graph is read from
+ * @param cache_dir 	Directory of the cache, if empty the entry is stored next to the source file
+ * @param kind 			How the source file is interpreted
+ *
+ * @return name of the cache file of the given source file
+ */
+string graph_cache_path(const string &source_file, const string &cache_dir, const string &kind)
+{
+	if (cache_dir.empty())
+		return source_file + "." + kind + ".pmc";
+
+	// Flatten the path so that files with the same name in different folders don't collide
+	string name = source_file;
+	for (char &c : name)
+	{
+		if (c == '/') c = '_';
+	}
+	return cache_dir + "/" + name + "." + kind + ".pmc";
+}
+
+/* Writes a cache entry for a graph.
+ * The entry is written in a temporary file then renamed, so that a concurrent reader
+ * never sees a partial file.
+ *
+ * @return true iff the entry was written
+ */
+bool write_graph_cache(const CSRGraph &graph, const string &cache_file, const string &source_file, const string &kind)
+{
+	GraphCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	strncpy(header.magic, "PMAXCUT", sizeof(header.magic));
+	header.version = GRAPH_CACHE_VERSION;
+	header.n = graph.n;
+	header.m = graph.m;
+	header.source_id = graph.source_id;
+	header.target_id = graph.target_id;
+	strncpy(header.kind, kind.c_str(), sizeof(header.kind) - 1);
+	header.data_size = CSRGraph::storage_size(graph.n, graph.m);
+	if (!source_stat(source_file, header.source_size, header.source_mtime)) return false;
+
+	string tmp_file = cache_file + ".tmp" + to_string(getpid());
+	FILE *f = fopen(tmp_file.c_str(), "wb");
+	if (f == NULL) return false;
+
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+		&& fwrite(graph.data(), 1, header.data_size, f) == header.data_size;
+	ok = (fclose(f) == 0) && ok;
+
+	if (!ok || rename(tmp_file.c_str(), cache_file.c_str()) != 0)
+	{
+		remove(tmp_file.c_str());
+		return false;
+	}
+	return true;
+}
+
+/* Loads a graph from its cache entry, by mapping the file in memory.
+ *
+ * @return true iff the entry exists, is valid and is up to date w.r.t. the source file.
+ * 		   Otherwise graph is left unchanged.
+ */
+bool load_graph_cache(const string &cache_file, const string &source_file, const string &kind, CSRGraph &graph)
+{
+	int64_t source_size, source_mtime;
+	if (!source_stat(source_file, source_size, source_mtime)) return false;
+
+	int fd = open(cache_file.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(GraphCacheHeader))
+	{
+		close(fd);
+		return false;
+	}
+
+	size_t size = st.st_size;
+	void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return false;
+
+	const GraphCacheHeader *header = (const GraphCacheHeader*)data;
+	char header_kind[sizeof(header->kind) + 1] = {0};
+	memcpy(header_kind, header->kind, sizeof(header->kind));
+
+	if (strncmp(header->magic, "PMAXCUT", sizeof(header->magic)) != 0
+		|| header->version != GRAPH_CACHE_VERSION
+		|| kind != header_kind
+		|| header->source_size != source_size
+		|| header->source_mtime != source_mtime
+		|| header->data_size != CSRGraph::storage_size(header->n, header->m)
+		|| size != sizeof(GraphCacheHeader) + header->data_size)
+	{
+		munmap(data, size);
+		return false;
+	}
+
+	// The mapping lives as long as the CSR graph (and its copies)
+	shared_ptr<const char> mapping((const char*)data, [size](const char *p) { munmap((void*)p, size); });
+	shared_ptr<const char> block(mapping, (const char*)data + sizeof(GraphCacheHeader));
+	graph = CSRGraph(block, header->n, header->m, header->source_id, header->target_id);
+	return true;
+}
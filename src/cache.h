@@ -0,0 +1,41 @@
+#pragma once
+
+#include "csr.h"
+#include <string>
+
+/* Binary on-disk cache of graphs
+ *
+ * A cache file is a GraphCacheHeader followed by the storage block of a CSRGraph
+ * (see csr.h), so it is loaded as a CSRGraph with a single mmap, without copy nor parsing.
+ * Callers that need a Graph still rebuild it with CSRGraph::to_graph (see read_graph_cached
+ * in main.cpp), which allocates its vertices and edges again.
+ * The header records the size and modification time of the file the graph was read
+ * from : the entry is considered stale as soon as that file changes.
+ * The kind string tells how the source file was interpreted (e.g. "pegasus", "sdf"),
+ * entries of another kind are ignored.
+ */
+
+/* Entries of another version are ignored. It must be incremented when the format changes, and
+ * also when the graph read from the same file changes : the dot parser (read_graph_from_file,
+ * read_graph_from_pegasus) or convert_to_SimpleDataFlow, since the key does not depend on them.
+ */
+#define GRAPH_CACHE_VERSION 1
+
+struct GraphCacheHeader
+{
+	char magic[8];		// "PMAXCUT"
+	uint32_t version;
+	uint32_t n, m;
+	int32_t source_id, target_id;
+	uint32_t reserved;
+	char kind[16];
+	int64_t source_size;
+	int64_t source_mtime; // in nanoseconds
+	uint64_t data_size;
+};
+
+static_assert(sizeof(GraphCacheHeader) % 8 == 0, "the CSR block must stay 8 bytes aligned");
+
+std::string graph_cache_path(const std::string &source_file, const std::string &cache_dir, const std::string &kind);
+bool write_graph_cache(const CSRGraph &graph, const std::string &cache_file, const std::string &source_file, const std::string &kind);
+bool load_graph_cache(const std::string &cache_file, const std::string &source_file, const std::string &kind, CSRGraph &graph);
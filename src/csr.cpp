@@ -0,0 +1,169 @@
+#include "csr.h"
+#include <vector>
+
+using namespace std;
+
+/* This file contains the CSR graph representation and its builder
+ */
+
+enum CSRArray
+{
+	CSR_TIME, CSR_MEMORY, CSR_WEIGHT,
+	CSR_EDGE_FROM, CSR_EDGE_TO,
+	CSR_OUT_OFFSETS, CSR_OUT_EDGES, CSR_OUT_HEADS,
+	CSR_IN_OFFSETS, CSR_IN_EDGES, CSR_IN_TAILS,
+	CSR_RED,
+	CSR_N_ARRAYS
+};
+
+/* Computes the position of each array in the storage block.
+ * Every array starts on an 8 bytes boundary.
+ *
+ * @return the total size of the block
+ */
+static size_t csr_layout(uint32_t n, uint32_t m, size_t offsets[CSR_N_ARRAYS])
+{
+	size_t sizes[CSR_N_ARRAYS] = {
+		n * sizeof(double), n * sizeof(double), m * sizeof(double),
+		m * sizeof(uint32_t), m * sizeof(uint32_t),
+		(n + 1) * sizeof(uint32_t), m * sizeof(uint32_t), m * sizeof(uint32_t),
+		(n + 1) * sizeof(uint32_t), m * sizeof(uint32_t), m * sizeof(uint32_t),
+		m * sizeof(uint8_t)
+	};
+
+	size_t pos = 0;
+	for (int i = 0; i < CSR_N_ARRAYS; ++i)
+	{
+		offsets[i] = pos;
+		pos += (sizes[i] + 7) & ~(size_t)7;
+	}
+	return pos;
+}
+
+size_t CSRGraph::storage_size(uint32_t n_vertices, uint32_t n_edges)
+{
+	size_t offsets[CSR_N_ARRAYS];
+	return csr_layout(n_vertices, n_edges, offsets);
+}
+
+CSRGraph::CSRGraph()
+{
+	n = m = 0;
+	source_id = target_id = -1;
+	storage = shared_ptr<const char>(new char[storage_size(0, 0)](), default_delete<const char[]>());
+	bind();
+}
+
+/* Builds a CSR graph on an existing block of memory, laid out as described in csr.h
+ * (for instance a block read from a cache file)
+ */
+CSRGraph::CSRGraph(shared_ptr<const char> block, uint32_t n_vertices, uint32_t n_edges, int32_t source, int32_t target)
+{
+	n = n_vertices;
+	m = n_edges;
+	source_id = source;
+	target_id = target;
+	storage = block;
+	bind();
+}
+
+/* Builds the CSR representation of a Graph, in O(n + m) */
+CSRGraph::CSRGraph(const Graph &graph)
+{
+	n = graph.n_vertices();
+	m = graph.n_edges();
+	source_id = graph.source_id;
+	target_id = graph.target_id;
+
+	size_t offsets[CSR_N_ARRAYS];
+	size_t size = csr_layout(n, m, offsets);
+	char *block = new char[size]();
+	storage = shared_ptr<const char>(block, default_delete<const char[]>());
+
+	double *w_time   = (double*)(block + offsets[CSR_TIME]);
+	double *w_memory = (double*)(block + offsets[CSR_MEMORY]);
+	double *w_weight = (double*)(block + offsets[CSR_WEIGHT]);
+	uint32_t *w_from = (uint32_t*)(block + offsets[CSR_EDGE_FROM]);
+	uint32_t *w_to   = (uint32_t*)(block + offsets[CSR_EDGE_TO]);
+	uint32_t *w_out_offsets = (uint32_t*)(block + offsets[CSR_OUT_OFFSETS]);
+	uint32_t *w_out_edges   = (uint32_t*)(block + offsets[CSR_OUT_EDGES]);
+	uint32_t *w_out_heads   = (uint32_t*)(block + offsets[CSR_OUT_HEADS]);
+	uint32_t *w_in_offsets  = (uint32_t*)(block + offsets[CSR_IN_OFFSETS]);
+	uint32_t *w_in_edges    = (uint32_t*)(block + offsets[CSR_IN_EDGES]);
+	uint32_t *w_in_tails    = (uint32_t*)(block + offsets[CSR_IN_TAILS]);
+	uint8_t *w_red = (uint8_t*)(block + offsets[CSR_RED]);
+
+	for (uint32_t v = 0; v < n; ++v)
+	{
+		w_time[v]   = graph.vertices[v].time;
+		w_memory[v] = graph.vertices[v].memory;
+	}
+
+	for (auto e : graph.edges)
+	{
+		w_weight[e->id] = e->weight;
+		w_from[e->id] = e->id_from;
+		w_to[e->id]   = e->id_to;
+		w_red[e->id]  = e->red;
+		++w_out_offsets[e->id_from + 1];
+		++w_in_offsets[e->id_to + 1];
+	}
+
+	for (uint32_t v = 0; v < n; ++v)
+	{
+		w_out_offsets[v + 1] += w_out_offsets[v];
+		w_in_offsets[v + 1]  += w_in_offsets[v];
+	}
+
+	// Counting sort of the edges by tail and by head, stable w.r.t. edge ids
+	vector<uint32_t> out_pos(w_out_offsets, w_out_offsets + n);
+	vector<uint32_t> in_pos(w_in_offsets, w_in_offsets + n);
+	for (uint32_t e = 0; e < m; ++e)
+	{
+		uint32_t k = out_pos[w_from[e]]++;
+		w_out_edges[k] = e;
+		w_out_heads[k] = w_to[e];
+
+		k = in_pos[w_to[e]]++;
+		w_in_edges[k] = e;
+		w_in_tails[k] = w_from[e];
+	}
+
+	bind();
+}
+
+// Sets the array pointers according to the layout of the storage block
+void CSRGraph::bind()
+{
+	size_t offsets[CSR_N_ARRAYS];
+	csr_layout(n, m, offsets);
+	const char *base = storage.get();
+
+	time   = (const double*)(base + offsets[CSR_TIME]);
+	memory = (const double*)(base + offsets[CSR_MEMORY]);
+	weight = (const double*)(base + offsets[CSR_WEIGHT]);
+	edge_from = (const uint32_t*)(base + offsets[CSR_EDGE_FROM]);
+	edge_to   = (const uint32_t*)(base + offsets[CSR_EDGE_TO]);
+	out_offsets = (const uint32_t*)(base + offsets[CSR_OUT_OFFSETS]);
+	out_edges   = (const uint32_t*)(base + offsets[CSR_OUT_EDGES]);
+	out_heads   = (const uint32_t*)(base + offsets[CSR_OUT_HEADS]);
+	in_offsets  = (const uint32_t*)(base + offsets[CSR_IN_OFFSETS]);
+	in_edges    = (const uint32_t*)(base + offsets[CSR_IN_EDGES]);
+	in_tails    = (const uint32_t*)(base + offsets[CSR_IN_TAILS]);
+	red = (const uint8_t*)(base + offsets[CSR_RED]);
+}
+
+/* Builds back a mutable Graph, with the same vertex and edge ids */
+Graph CSRGraph::to_graph() const
+{
+	Graph res;
+	res.reserve(n, m);
+	for (uint32_t v = 0; v < n; ++v)
+		res.add_vertex(time[v], memory[v]);
+	for (uint32_t e = 0; e < m; ++e)
+		res.add_edge(edge_from[e], edge_to[e], weight[e], red[e]);
+
+	res.source_id = source_id;
+	res.target_id = target_id;
+	return res;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "graph.h"
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+/* Immutable compressed sparse row (CSR) representation of a Graph
+ *
+ * Vertices and edges keep the ids they have in the Graph it was built from.
+ * All the arrays live in a single block of memory (struct of arrays) :
+ *   time[n], memory[n], weight[m]                  (double)
+ *   edge_from[m], edge_to[m]                       (uint32_t, indexed by edge id)
+ *   out_offsets[n+1], out_edges[m], out_heads[m]   (uint32_t, edges sorted by tail)
+ *   in_offsets[n+1], in_edges[m], in_tails[m]      (uint32_t, edges sorted by head)
+ *   red[m]                                         (uint8_t)
+ * The out-edges of v are out_edges[out_offsets[v] .. out_offsets[v+1]-1], and
+ * out_heads[k] is the head of out_edges[k] (same for the in-edges).
+ *
+ * Copies are cheap : the block is shared and never modified.
+ */
+class CSRGraph
+{
+private:
+	std::shared_ptr<const char> storage;
+	void bind();
+
+public:
+	uint32_t n, m;
+	int32_t source_id, target_id; // -1 if not set
+
+	const double *time;
+	const double *memory;
+	const double *weight;
+	const uint32_t *edge_from;
+	const uint32_t *edge_to;
+	const uint32_t *out_offsets;
+	const uint32_t *out_edges;
+	const uint32_t *out_heads;
+	const uint32_t *in_offsets;
+	const uint32_t *in_edges;
+	const uint32_t *in_tails;
+	const uint8_t *red;
+
+	CSRGraph();
+	CSRGraph(const Graph &graph);
+	CSRGraph(std::shared_ptr<const char> block, uint32_t n_vertices, uint32_t n_edges, int32_t source, int32_t target);
+
+	Graph to_graph() const;
+
+	static size_t storage_size(uint32_t n_vertices, uint32_t n_edges);
+
+	inline const char* data() const
+	{
+		return storage.get();
+	}
+
+	inline int n_vertices() const
+	{
+		return n;
+	}
+
+	inline int n_edges() const
+	{
+		return m;
+	}
+
+	inline int out_degree(uint32_t v) const
+	{
+		return out_offsets[v + 1] - out_offsets[v];
+	}
+
+	inline int in_degree(uint32_t v) const
+	{
+		return in_offsets[v + 1] - in_offsets[v];
+	}
+};
@@ -0,0 +1,457 @@
+#include "dot.h"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/* This file contains a native parser for dot files, that does not depend on Graphviz.
+ */
+
+enum DotTokenKind
+{
+	DOT_ID,		// identifier, numeral, quoted or HTML string
+	DOT_EDGEOP,	// -> or --
+	DOT_PUNCT,	// { } [ ] ; , = :
+	DOT_END
+};
+
+struct DotToken
+{
+	DotTokenKind kind;
+	string_view text;
+};
+
+class DotParser
+{
+private:
+	const char *begin, *p, *end;
+	int line;
+	string filename;
+	DotReader &out;
+
+	DotToken tok;
+	bool strict;
+
+	vector<double> node_defaults, edge_defaults;
+	unordered_map<string_view, int> node_ids;
+	unordered_map<unsigned long long, int> edge_ids; // only for strict graphs
+	string buffer;
+
+	void error(const string &msg);
+	void skip_blanks();
+	void next();
+	bool is_punct(char c);
+	bool is_keyword(const char *keyword);
+	void expect_punct(char c);
+
+	double to_double(string_view value);
+	void parse_attributes(const vector<string> &labels, double *values);
+	void skip_attributes();
+	int get_node(string_view name);
+	void parse_statement();
+
+public:
+	DotParser(const char *begin, const char *end, const string &filename, DotReader &out);
+	void parse();
+};
+
+DotParser::DotParser(const char *begin, const char *end, const string &filename, DotReader &out)
+	: begin(begin), p(begin), end(end), line(1), filename(filename), out(out), strict(false)
+{
+	node_defaults.assign(out.node_labels.size(), NAN);
+	edge_defaults.assign(out.edge_labels.size(), NAN);
+}
+
+void DotParser::error(const string &msg)
+{
+	throw runtime_error(filename + ":" + to_string(line) + ": " + msg);
+}
+
+// Skips white spaces, comments and preprocessor lines
+void DotParser::skip_blanks()
+{
+	bool line_start = (p == begin || p[-1] == '\n');
+	while (p < end)
+	{
+		char c = *p;
+		if (c == '\n')
+		{
+			++line;
+			++p;
+			line_start = true;
+		}
+		else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v')
+		{
+			++p;
+		}
+		else if (c == '#' && line_start)
+		{
+			while (p < end && *p != '\n') ++p;
+		}
+		else if (c == '/' && p + 1 < end && p[1] == '/')
+		{
+			while (p < end && *p != '\n') ++p;
+		}
+		else if (c == '/' && p + 1 < end && p[1] == '*')
+		{
+			p += 2;
+			while (p + 1 < end && !(p[0] == '*' && p[1] == '/'))
+			{
+				if (*p == '\n') ++line;
+				++p;
+			}
+			if (p + 1 >= end) error("unterminated comment");
+			p += 2;
+		}
+		else
+		{
+			return;
+		}
+	}
+}
+
+static inline bool is_id_char(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+		|| c == '_' || c == '.' || (unsigned char)c >= 128;
+}
+
+// Reads the next token in tok
+void DotParser::next()
+{
+	skip_blanks();
+	if (p >= end)
+	{
+		tok = {DOT_END, string_view()};
+		return;
+	}
+
+	const char *start = p;
+	char c = *p;
+	if (c == '"')
+	{
+		++p;
+		while (p < end && *p != '"')
+		{
+			if (*p == '\\' && p + 1 < end) ++p;
+			if (*p == '\n') ++line;
+			++p;
+		}
+		if (p >= end) error("unterminated string");
+		++p;
+		tok = {DOT_ID, string_view(start + 1, p - start - 2)};
+	}
+	else if (c == '<')
+	{
+		int depth = 0;
+		do
+		{
+			if (*p == '<') ++depth;
+			else if (*p == '>') --depth;
+			else if (*p == '\n') ++line;
+			++p;
+		} while (p < end && depth > 0);
+		if (depth > 0) error("unterminated HTML string");
+		tok = {DOT_ID, string_view(start + 1, p - start - 2)};
+	}
+	else if (c == '-' && p + 1 < end && (p[1] == '>' || p[1] == '-'))
+	{
+		p += 2;
+		tok = {DOT_EDGEOP, string_view(start, 2)};
+	}
+	else if (is_id_char(c) || c == '-')
+	{
+		++p;
+		while (p < end && is_id_char(*p)) ++p;
+		tok = {DOT_ID, string_view(start, p - start)};
+	}
+	else if (strchr("{}[];,=:", c))
+	{
+		++p;
+		tok = {DOT_PUNCT, string_view(start, 1)};
+	}
+	else
+	{
+		error(string("unexpected character '") + c + "'");
+	}
+}
+
+bool DotParser::is_punct(char c)
+{
+	return tok.kind == DOT_PUNCT && tok.text[0] == c;
+}
+
+// Keywords of the dot language are case insensitive
+bool DotParser::is_keyword(const char *keyword)
+{
+	if (tok.kind != DOT_ID || tok.text.size() != strlen(keyword)) return false;
+	for (size_t i = 0; i < tok.text.size(); ++i)
+	{
+		if (tolower(tok.text[i]) != keyword[i]) return false;
+	}
+	return true;
+}
+
+void DotParser::expect_punct(char c)
+{
+	if (!is_punct(c)) error(string("expected '") + c + "'");
+	next();
+}
+
+double DotParser::to_double(string_view value)
+{
+	if (value.empty()) return NAN;
+
+	buffer.assign(value.data(), value.size());
+	char *stop;
+	double res = strtod(buffer.c_str(), &stop);
+	if (stop == buffer.c_str())
+		error("invalid numeric value \"" + buffer + "\"");
+	return res;
+}
+
+/* Parses one or more attribute lists [k=v, ...] and stores the values of the
+ * attributes listed in labels
+ */
+void DotParser::parse_attributes(const vector<string> &labels, double *values)
+{
+	while (is_punct('['))
+	{
+		next();
+		while (!is_punct(']'))
+		{
+			if (tok.kind != DOT_ID) error("expected attribute name");
+			string_view key = tok.text;
+			next();
+			expect_punct('=');
+			if (tok.kind != DOT_ID) error("expected attribute value");
+
+			for (size_t k = 0; k < labels.size(); ++k)
+			{
+				if (labels[k] == key)
+					values[k] = to_double(tok.text);
+			}
+			next();
+			if (is_punct(',') || is_punct(';')) next();
+		}
+		next();
+	}
+}
+
+void DotParser::skip_attributes()
+{
+	vector<string> none;
+	parse_attributes(none, nullptr);
+}
+
+// Returns the index of the node with the given name, creating it if needed
+int DotParser::get_node(string_view name)
+{
+	auto it = node_ids.find(name);
+	if (it != node_ids.end()) return it->second;
+
+	buffer.assign(name.data(), name.size());
+	char *stop;
+	long value = strtol(buffer.c_str(), &stop, 10);
+	if (stop == buffer.c_str())
+		error("node name \"" + buffer + "\" is not an integer");
+
+	int id = out.node_names.size();
+	node_ids[name] = id;
+	out.node_names.push_back(value);
+	out.node_values.insert(out.node_values.end(), node_defaults.begin(), node_defaults.end());
+	return id;
+}
+
+void DotParser::parse_statement()
+{
+	if (is_keyword("node"))
+	{
+		next();
+		parse_attributes(out.node_labels, node_defaults.data());
+	}
+	else if (is_keyword("edge"))
+	{
+		next();
+		parse_attributes(out.edge_labels, edge_defaults.data());
+	}
+	else if (is_keyword("graph"))
+	{
+		next();
+		skip_attributes();
+	}
+	else if (is_keyword("subgraph") || is_punct('{'))
+	{
+		error("subgraphs are not supported");
+	}
+	else if (tok.kind == DOT_ID)
+	{
+		string_view name = tok.text;
+		next();
+		if (is_punct('='))
+		{
+			// Graph attribute
+			next();
+			next();
+			return;
+		}
+
+		vector<int> chain;
+		chain.push_back(get_node(name));
+		if (is_punct(':')) // ports are ignored
+		{
+			next(); next();
+			if (is_punct(':')) { next(); next(); }
+		}
+		while (tok.kind == DOT_EDGEOP)
+		{
+			next();
+			if (tok.kind != DOT_ID) error("expected node name");
+			chain.push_back(get_node(tok.text));
+			next();
+			if (is_punct(':'))
+			{
+				next(); next();
+				if (is_punct(':')) { next(); next(); }
+			}
+		}
+
+		size_t n_labels = out.node_labels.size();
+		if (chain.size() == 1)
+		{
+			parse_attributes(out.node_labels, out.node_values.data() + chain[0] * n_labels);
+			return;
+		}
+
+		vector<double> values(edge_defaults);
+		parse_attributes(out.edge_labels, values.data());
+		for (size_t i = 0; i + 1 < chain.size(); ++i)
+		{
+			int a = chain[i], b = chain[i + 1];
+			if (strict)
+			{
+				unsigned long long key = ((unsigned long long)a << 32) | (unsigned)b;
+				auto it = edge_ids.find(key);
+				if (it != edge_ids.end())
+				{
+					// Strict graphs merge multi-edges : only update the attributes that were set
+					double *old = out.edge_values.data() + it->second * out.edge_labels.size();
+					for (size_t k = 0; k < values.size(); ++k)
+					{
+						if (!isnan(values[k])) old[k] = values[k];
+					}
+					continue;
+				}
+				edge_ids[key] = out.edge_from.size();
+			}
+			out.edge_from.push_back(a);
+			out.edge_to.push_back(b);
+			out.edge_values.insert(out.edge_values.end(), values.begin(), values.end());
+		}
+	}
+	else
+	{
+		error("unexpected token");
+	}
+}
+
+void DotParser::parse()
+{
+	next();
+	if (is_keyword("strict"))
+	{
+		strict = true;
+		next();
+	}
+	if (!is_keyword("digraph") && !is_keyword("graph")) error("expected graph or digraph");
+	next();
+	if (tok.kind == DOT_ID) next();
+	expect_punct('{');
+
+	while (!is_punct('}'))
+	{
+		if (tok.kind == DOT_END) error("unexpected end of file");
+		parse_statement();
+		if (is_punct(';')) next();
+	}
+}
+
+DotReader::DotReader(const vector<string> &node_labels, const vector<string> &edge_labels)
+	: node_labels(node_labels), edge_labels(edge_labels)
+{
+}
+
+/* Reads a dot file.
+ * Throws a runtime_error if the file cannot be read or parsed.
+ *
+ * @param filename Name of the file to read
+ */
+void DotReader::read(const string &filename)
+{
+	node_names.clear();
+	node_values.clear();
+	edge_from.clear();
+	edge_to.clear();
+	edge_values.clear();
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) throw runtime_error(filename + ": cannot open file");
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size == 0)
+	{
+		close(fd);
+		throw runtime_error(filename + ": cannot read file");
+	}
+
+	size_t size = st.st_size;
+	void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) throw runtime_error(filename + ": cannot map file");
+	madvise(data, size, MADV_SEQUENTIAL);
+
+	try
+	{
+		DotParser parser((const char*)data, (const char*)data + size, filename, *this);
+		parser.parse();
+	}
+	catch (...)
+	{
+		munmap(data, size);
+		throw;
+	}
+	munmap(data, size);
+
+	// Order the edges by tail, as cgraph does (stable counting sort)
+	int n = n_nodes(), m = n_edges();
+	size_t n_labels = edge_labels.size();
+	vector<int> pos(n + 1, 0);
+	for (int e = 0; e < m; ++e)
+		++pos[edge_from[e] + 1];
+	for (int v = 0; v < n; ++v)
+		pos[v + 1] += pos[v];
+
+	vector<int> from(m), to(m);
+	vector<double> values(edge_values.size());
+	for (int e = 0; e < m; ++e)
+	{
+		int k = pos[edge_from[e]]++;
+		from[k] = edge_from[e];
+		to[k] = edge_to[e];
+		for (size_t l = 0; l < n_labels; ++l)
+			values[k * n_labels + l] = edge_values[e * n_labels + l];
+	}
+	edge_from.swap(from);
+	edge_to.swap(to);
+	edge_values.swap(values);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+/* Single pass reader for the subset of the dot language used by our datasets
+ *
+ * Supported : [strict] (graph|digraph) [name] { ... } with node statements, edge
+ * statements (a -> b -> c), attribute lists, graph/node/edge default attributes,
+ * quoted strings and comments. Subgraphs are not supported.
+ * The file is memory-mapped and parsed in place, in time linear in its size.
+ *
+ * Only the attributes listed in node_labels / edge_labels are extracted, as doubles
+ * (NAN when the attribute is not set). Nodes are numbered in order of first appearance
+ * and edges are ordered as cgraph iterates them : by tail node, then by order of appearance.
+ */
+class DotReader
+{
+public:
+	std::vector<std::string> node_labels;
+	std::vector<std::string> edge_labels;
+
+	std::vector<long> node_names;	 // integer value of the name of each node
+	std::vector<double> node_values; // value of node_labels[k] for node i at i * node_labels.size() + k
+	std::vector<int> edge_from, edge_to;
+	std::vector<double> edge_values; // value of edge_labels[k] for edge i at i * edge_labels.size() + k
+
+	DotReader(const std::vector<std::string> &node_labels, const std::vector<std::string> &edge_labels);
+
+	void read(const std::string &filename);
+
+	inline int n_nodes() const
+	{
+		return node_names.size();
+	}
+
+	inline int n_edges() const
+	{
+		return edge_from.size();
+	}
+
+	inline double node_value(int i, int k) const
+	{
+		return node_values[i * node_labels.size() + k];
+	}
+
+	inline double edge_value(int i, int k) const
+	{
+		return edge_values[i * edge_labels.size() + k];
+	}
+};
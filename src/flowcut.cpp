@@ -0,0 +1,456 @@
+#include "pmaxcut.h"
+#include "backend.h"
+#include "maxflow.h"
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+/* This file contains the combinatorial (LP solver free) cut algorithms.
+ *
+ * The LP of get_maxcut_lin maximizes sum_{(a,b)} w_ab (p_a - p_b) = sum_v c_v p_v
+ * with c_v = (weight out of v) - (weight into v), under p_a >= p_b for every edge,
+ * p_source = 1 and p_target = 0. This is a maximum weight closure problem (S must contain
+ * the predecessors of its vertices), the dual of the min-flow with lower bounds, and is
+ * solved by a single max-flow computation.
+ */
+
+/* Maximum weight closure : computes the topological cut (S, T) maximizing the sum of the
+ * given weights over the edges from S to T (weights may be negative).
+ *
+ * @param graph 	the DAG in CSR format, with source and target set
+ * @param weight 	weight of each edge, indexed by edge id
+ * @param side 		side[v] will be true iff v is in S
+ */
+static void max_closure(const CSRGraph &graph, const double *weight, vector<bool> &side)
+{
+	int source = graph.source_id, target = graph.target_id;
+	int n = graph.n_vertices();
+	int m = graph.n_edges();
+	const double inf = numeric_limits<double>::infinity();
+
+	vector<double> c(n, 0);
+	for (int e = 0; e < m; ++e)
+	{
+		c[graph.edge_from[e]] += weight[e];
+		c[graph.edge_to[e]]   -= weight[e];
+	}
+	// Relative to the largest capacity, not to the sum of the weights : with the large multipliers
+	// of the Lagrangian search, that sum would make the small capacities of large graphs vanish
+	double largest = 0;
+	for (int v = 0; v < n; ++v)
+		largest = max(largest, fabs(c[v]));
+
+	// Nodes 0..n-1 are the vertices of the graph, n is the super source, n+1 the super sink
+	MaxFlow network(n + 2);
+	network.tolerance = 1e-12 * max(1.0, largest);
+	int s = n, t = n + 1;
+	for (int v = 0; v < n; ++v)
+	{
+		if (c[v] > 0)
+			network.add_arc(s, v, c[v]);
+		else if (c[v] < 0)
+			network.add_arc(v, t, -c[v]);
+	}
+	network.add_arc(s, source, inf);
+	network.add_arc(target, t, inf);
+
+	// If b is in S, then a must be in S
+	for (int e = 0; e < m; ++e)
+		network.add_arc(graph.edge_to[e], graph.edge_from[e], inf);
+
+	network.run(s, t);
+	network.source_side(s, side);
+	side.resize(n);
+}
+
+/**
+ * @private
+ *  Compute the maximum topological cut of a DAG in CSR format with a max-flow algorithm
+ *  Same outputs as get_maxcut_lin, without using an LP solver.
+ *
+ * @param graph	the DAG in CSR format
+ * @param cut 	vector that will contain the edges of the cut
+ * @param S 	vector that will contain the S set after the cut
+ * @param T		vector that will contain the T set after the cut
+ * @param res 	double where the max cut value will be stored
+ *
+ *
+ * @return 0 if everything went well, 3 if the source or the target are not set.
+ */
+int get_maxcut_flow_csr(const CSRGraph &graph,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res)
+{
+	int source = graph.source_id, target = graph.target_id;
+	if (source == -1 || target == -1) return 3;
+
+	cut.clear();
+	S.clear();
+	T.clear();
+
+	int n = graph.n_vertices();
+	int m = graph.n_edges();
+
+	vector<bool> side;
+	max_closure(graph, graph.weight, side);
+
+	res = 0;
+	for (int e = 0; e < m; ++e)
+	{
+		if (side[graph.edge_from[e]] && !side[graph.edge_to[e]])
+		{
+			res += graph.weight[e];
+			cut.push_back(e);
+		}
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		if (side[i])
+			S.push_back(i);
+		else
+			T.push_back(i);
+	}
+
+	return 0;
+}
+
+/**
+ * @private
+ *  Compute the maximum topological cut of a DAG with a max-flow algorithm
+ *  Same outputs as get_maxcut_lin, without using an LP solver.
+ *
+ * @param graph	the DAG in Graph format
+ * @param cut 	vector that will contain the edges of the cut
+ * @param S 	vector that will contain the S set after the cut
+ * @param T		vector that will contain the T set after the cut
+ * @param res 	double where the max cut value will be stored
+ *
+ *
+ * @return 0 if everything went well, 3 if the source or the target are not set.
+ */
+int get_maxcut_flow(const Graph &graph,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res)
+{
+	return get_maxcut_flow_csr(CSRGraph(graph), cut, S, T, res);
+}
+
+/* Evaluates the Lagrangian relaxation of the p-maxcut for the multiplier lambda of the
+ * proc_count <= p constraint : computes a maxcut where the weight of each red edge is
+ * reduced by lambda.
+ *
+ * @param graph 	the DAG in CSR format
+ * @param lambda 	multiplier of the proc_count constraint
+ * @param weights 	buffer for the reduced weights
+ *
+ * @return the cut found, with its number of red edges and its (non reduced) weight
+ */
+static PMaxcutBreakpoint lagrangian_cut(const CSRGraph &graph, double lambda, vector<double> &weights)
+{
+	int n = graph.n_vertices();
+	int m = graph.n_edges();
+
+	weights.resize(m);
+	for (int e = 0; e < m; ++e)
+		weights[e] = graph.weight[e] - ((graph.red[e]) ? lambda : 0);
+
+	vector<bool> side;
+	max_closure(graph, weights.data(), side);
+
+	PMaxcutBreakpoint point;
+	point.red = 0;
+	point.weight = 0;
+	for (int e = 0; e < m; ++e)
+	{
+		if (side[graph.edge_from[e]] && !side[graph.edge_to[e]])
+		{
+			point.weight += graph.weight[e];
+			point.red += graph.red[e];
+		}
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		if (side[i])
+			point.S.push_back(i);
+	}
+	return point;
+}
+
+/**
+ * @private
+ *  Compute the value of the LP relaxation of the p-maxcut for every value of p at once.
+ *
+ *  The LP value is a concave piecewise linear function of p : its breakpoints are the cuts
+ *  on the upper concave hull of the points (number of red edges, weight) of all the
+ *  topological cuts. They are found by Lagrangian relaxation of the proc_count constraint
+ *  (Eisner-Severance search on the multiplier), each evaluation being a max-flow.
+ *  For p between the red counts of two consecutive breakpoints, an optimal LP solution
+ *  is the convex combination of their cuts.
+ * 
+ * @param graph			the DAG in Graph format
+ * @param breakpoints 	vector that will contain the breakpoints, by increasing number of red edges
+ * @param values 		vector that will contain the LP value for p = 0 .. number of red edges
+ * 						(-1 if the LP is infeasible for that p)
+ *
+ *
+ * @return 0 if everything went well, 3 if the source or the target are not set.
+ */
+int get_p_maxcut_sweep(const Graph &graph, vector<PMaxcutBreakpoint> &breakpoints, vector<double> &values)
+{
+	int source = graph.source_id, target = graph.target_id;
+	if (source == -1 || target == -1) return 3;
+
+	breakpoints.clear();
+	values.clear();
+
+	CSRGraph csr(graph);
+	double total = 0;
+	int n_red = 0;
+	for (auto e : graph.edges)
+	{
+		total += fabs(e->weight);
+		n_red += e->red;
+	}
+	double tol = 1e-9 * max(1.0, total);
+
+	vector<double> weights;
+	// With lambda > total weight, the cut has as few red edges as possible
+	breakpoints.push_back(lagrangian_cut(csr, total + 1, weights));
+	vector<PMaxcutBreakpoint> pending;
+	pending.push_back(lagrangian_cut(csr, 0, weights));
+
+	while (!pending.empty())
+	{
+		PMaxcutBreakpoint &a = breakpoints.back();
+		PMaxcutBreakpoint &b = pending.back();
+
+		// b is dominated by a
+		if (b.red <= a.red || b.weight <= a.weight + tol)
+		{
+			pending.pop_back();
+			continue;
+		}
+
+		double lambda = (b.weight - a.weight) / (b.red - a.red);
+		PMaxcutBreakpoint c = lagrangian_cut(csr, lambda, weights);
+		if (c.red > a.red && c.red < b.red
+			&& c.weight - lambda * c.red > a.weight - lambda * a.red + tol)
+		{
+			// c is above the segment [a, b]
+			pending.push_back(c);
+		}
+		else
+		{
+			breakpoints.push_back(b);
+			pending.pop_back();
+		}
+	}
+
+	values.assign(n_red + 1, -1);
+	size_t k = 0;
+	for (int p = breakpoints[0].red; p <= n_red; ++p)
+	{
+		while (k + 1 < breakpoints.size() && breakpoints[k + 1].red <= p)
+			++k;
+
+		if (k + 1 == breakpoints.size())
+		{
+			values[p] = breakpoints[k].weight;
+		}
+		else
+		{
+			const PMaxcutBreakpoint &a = breakpoints[k], &b = breakpoints[k + 1];
+			values[p] = a.weight + (b.weight - a.weight) * (p - a.red) / (b.red - a.red);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @private
+ *  Compute an upper bound on the p-maxcut and a feasible cut without an LP solver,
+ *  by Lagrangian relaxation of the proc_count <= p_max constraint.
+ *
+ *  Each evaluation of the dual function is a maxcut where the weight of the red edges is
+ *  reduced by the multiplier lambda. The multiplier is searched by dichotomy on the
+ *  breakpoints around p_max (each step is the slope between the best known cuts with at
+ *  most / more than p_max red edges), so the bound is the optimal Lagrangian bound, which
+ *  is equal to the value of the LP relaxation.
+ *  The feasible cut is the best among the cuts with at most p_max red edges found during
+ *  the search and the threshold roundings of the final fractional solution.
+ * 
+ * @param graph	the DAG in Graph format
+ * @param p_max value of p
+ * @param cut 	vector that will contain the edges of the best feasible cut found
+ * @param S 	vector that will contain the S set after the cut
+ * @param T		vector that will contain the T set after the cut
+ * @param res 	double where the value of the feasible cut will be stored
+ * @param bound double where the Lagrangian upper bound will be stored
+ *
+ *
+ * @return 0 if everything went well, 2 if no cut has at most p_max red edges, 3 if the source or the target are not set.
+ */
+int get_p_maxcut_lagrangian(const Graph &graph, int p_max,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res, double &bound)
+{
+	int source = graph.source_id, target = graph.target_id;
+	if (source == -1 || target == -1) return 3;
+
+	cut.clear();
+	S.clear();
+	T.clear();
+	res = bound = -1;
+
+	int n = graph.n_vertices();
+	FlowBackend backend(graph);
+	// a : best cut with at most p_max red edges, b : cut with more than p_max red edges
+	PMaxcutBreakpoint a, b;
+	int err = backend.bracket(p_max, a, b, bound);
+	if (err) return err;
+
+	// Best feasible cut : a, or a threshold rounding of the optimal fractional solution
+	vector<bool> in_a(n, false);
+	vector<double> pi_values(n, 0);
+	for (int v : a.S)
+		in_a[v] = true;
+	if (b.red > p_max && b.red != a.red)
+	{
+		double alpha = (double)(b.red - p_max) / (b.red - a.red);
+		for (int v : a.S)
+			pi_values[v] += alpha;
+		for (int v : b.S)
+			pi_values[v] += 1 - alpha;
+		round_p_maxcut(graph, pi_values, p_max, cut, S, T, res);
+	}
+
+	if (res < a.weight)
+	{
+		res = 0;
+		cut.clear();
+		S.clear();
+		T.clear();
+		for (auto e : graph.edges)
+		{
+			if (in_a[e->id_from] && !in_a[e->id_to])
+			{
+				res += e->weight;
+				cut.push_back(e->id);
+			}
+		}
+		for (int i = 0; i < n; ++i)
+		{
+			if (in_a[i])
+				S.push_back(i);
+			else
+				T.push_back(i);
+		}
+	}
+
+	return 0;
+}
+
+/* Builds the flow backend of a graph, with source and target set.
+ * No max-flow is computed before the first solve.
+ */
+FlowBackend::FlowBackend(const Graph &graph) : graph(graph)
+{
+	total = 0;
+	for (auto e : graph.edges)
+		total += fabs(e->weight);
+	tol = 1e-9 * max(1.0, total);
+	evaluations = 0;
+}
+
+// Lagrangian cut for lambda, added to the known cuts
+const PMaxcutBreakpoint& FlowBackend::evaluate(double lambda)
+{
+	++evaluations;
+	PMaxcutBreakpoint c = lagrangian_cut(graph, lambda, weights);
+
+	// Two cuts of the concave hull with the same number of red edges have the same weight
+	auto it = lower_bound(known.begin(), known.end(), c.red, [](const PMaxcutBreakpoint &x, int red)
+	{
+		return x.red < red;
+	});
+	if (it != known.end() && it->red == c.red)
+		return *it;
+	return *known.insert(it, c);
+}
+
+/* Finds the cuts of the concave hull of the (number of red edges, weight) of the cuts
+ * that are around p_max, as get_p_maxcut_lagrangian.
+ *
+ * @param p_max value of p
+ * @param a 	will contain the best cut with at most p_max red edges
+ * @param b 	will contain the next cut of the hull, with more than p_max red edges
+ * 				(or a if the maxcut has at most p_max red edges)
+ * @param bound will contain the value of the LP
+ *
+ * @return 0 if everything went well, 2 if no cut has at most p_max red edges
+ */
+int FlowBackend::bracket(int p_max, PMaxcutBreakpoint &a, PMaxcutBreakpoint &b, double &bound)
+{
+	if (known.empty())
+	{
+		// With lambda > total weight, the cut has as few red edges as possible
+		evaluate(total + 1);
+		// The number of red edges decreases with lambda : the maxcut has the most red edges
+		evaluate(0);
+	}
+	if (known.front().red > p_max) return 2;
+
+	size_t k = 0;
+	while (k + 1 < known.size() && known[k + 1].red <= p_max)
+		++k;
+	a = known[k];
+	if (k + 1 == known.size())
+	{
+		// The maxcut is feasible
+		b = a;
+		bound = a.weight;
+		return 0;
+	}
+	b = known[k + 1];
+
+	while (b.weight > a.weight + tol)
+	{
+		double lambda = (b.weight - a.weight) / (b.red - a.red);
+		PMaxcutBreakpoint c = evaluate(lambda);
+		if (c.red == a.red || c.red == b.red
+			|| c.weight - lambda * c.red <= a.weight - lambda * a.red + tol)
+			break; // lambda is optimal
+
+		if (c.red <= p_max)
+			a = c;
+		else
+			b = c;
+	}
+
+	bound = a.weight + (b.weight - a.weight) * (p_max - a.red) / (b.red - a.red);
+	return 0;
+}
+
+/* Solves the LP, the solution is the convex combination of the cuts around p_max.
+ * The ILP is not supported : integral is ignored.
+ * The iterations are the max-flow computations.
+ */
+int FlowBackend::solve(int p_max, bool /*integral*/, vector<double> &pi_values, double &bound, SolverStats *stats)
+{
+	int start = evaluations;
+	PMaxcutBreakpoint a, b;
+	int err = bracket(p_max, a, b, bound);
+	if (err) return err;
+
+	double alpha = (b.red > p_max) ? (double)(b.red - p_max) / (b.red - a.red) : 1;
+	pi_values.assign(graph.n_vertices(), 0);
+	for (int v : a.S)
+		pi_values[v] += alpha;
+	for (int v : b.S)
+		pi_values[v] += 1 - alpha;
+
+	if (stats)
+		stats->iterations = evaluations - start;
+	return 0;
+}
@@ -0,0 +1,193 @@
+#include "generator.h"
+#include "runner.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+/* This file contains the seeded random DAG generators
+ */
+
+// Number of pairs skipped before the next edge, when each pair is an edge with probability p
+static uint64_t geometric_skip(double p, mt19937_64 &rng)
+{
+	if (p >= 1) return 0;
+	if (p <= 0) return UINT64_MAX;
+	uniform_real_distribution<double> uniform(0, 1);
+	double skip = floor(log(1 - uniform(rng)) / log(1 - p));
+	return (skip >= (double)UINT64_MAX) ? UINT64_MAX : (uint64_t)skip;
+}
+
+static void add_vertices(Graph &graph, int n, const DagWeights &weights, mt19937_64 &rng)
+{
+	uniform_real_distribution<double> uniform(0, 1);
+	for (int i = 0; i < n; ++i)
+	{
+		double t = uniform(rng) * weights.t_max;
+		double w = uniform(rng) * weights.w_max;
+		graph.add_vertex(t, w);
+	}
+}
+
+static void add_edge(Graph &graph, int from, int to, const DagWeights &weights, mt19937_64 &rng)
+{
+	uniform_real_distribution<double> uniform(0, 1);
+	graph.add_edge(from, to, uniform(rng) * weights.w_max_edges);
+}
+
+/* Generates a random DAG and converts it to SDFM
+ *
+ * @param n 			Number of vertices
+ * @param connectedness Each edge (i,j), i < j exists with probability connectedness
+ * @param weights 		Bounds of the weights
+ * @param rng 			Random generator of the instance
+ *
+ * @return a random DAG generated as stated above, converted to SimpleDataFlowModel
+ */
+Graph generate_random_dag(int n, double connectedness, const DagWeights &weights, mt19937_64 &rng)
+{
+	Graph res;
+	add_vertices(res, n, weights, rng);
+
+	// Pairs (i,j), i < j, numbered by j then i : pair k of column j is (k, j)
+	uint64_t i = 0, j = 1;
+	while (j < (uint64_t)n)
+	{
+		uint64_t skip = geometric_skip(connectedness, rng);
+		if (skip == UINT64_MAX) break;
+		i += skip;
+		while (j < (uint64_t)n && i >= j)
+		{
+			i -= j;
+			++j;
+		}
+		if (j >= (uint64_t)n) break;
+		add_edge(res, i, j, weights, rng);
+		++i;
+	}
+
+	return convert_to_SimpleDataFlow(res);
+}
+
+/* Generates a layered DAG and converts it to SDFM
+ *
+ * @param n_layers 		Number of layers
+ * @param width 		Number of vertices per layer
+ * @param connectedness Each edge between two consecutive layers exists with probability connectedness
+ * @param weights 		Bounds of the weights
+ * @param rng 			Random generator of the instance
+ *
+ * @return a layered DAG generated as stated above, converted to SimpleDataFlowModel
+ */
+Graph generate_layered_dag(int n_layers, int width, double connectedness, const DagWeights &weights, mt19937_64 &rng)
+{
+	Graph res;
+	add_vertices(res, n_layers * width, weights, rng);
+
+	uint64_t pairs = (uint64_t)width * width;
+	for (int l = 1; l < n_layers; ++l)
+	{
+		int first = (l - 1) * width;
+		vector<bool> has_pred(width, false);
+
+		// Pair k is (first + k % width, first + width + k / width)
+		uint64_t k = geometric_skip(connectedness, rng);
+		while (k < pairs)
+		{
+			int to = k / width;
+			add_edge(res, first + k % width, first + width + to, weights, rng);
+			has_pred[to] = true;
+			uint64_t skip = geometric_skip(connectedness, rng);
+			k = (skip >= pairs) ? pairs : k + 1 + skip;
+		}
+
+		uniform_int_distribution<int> pick(0, width - 1);
+		for (int v = 0; v < width; ++v)
+		{
+			if (!has_pred[v])
+				add_edge(res, first + pick(rng), first + width + v, weights, rng);
+		}
+	}
+
+	return convert_to_SimpleDataFlow(res);
+}
+
+/* Generates a fan-out / fan-in workflow and converts it to SDFM
+ *
+ * @param n 			Number of vertices (at least)
+ * @param fan_max 		Maximum number of chains started by a vertex
+ * @param chain_max 	Maximum number of tasks of a chain
+ * @param weights 		Bounds of the weights
+ * @param rng 			Random generator of the instance
+ *
+ * @return a workflow generated as stated above, converted to SimpleDataFlowModel
+ */
+Graph generate_fan_dag(int n, int fan_max, int chain_max, const DagWeights &weights, mt19937_64 &rng)
+{
+	Graph res;
+	res.reserve(n + fan_max * chain_max + 1, 2 * n);
+	uniform_int_distribution<int> fan(1, max(1, fan_max)), chain(1, max(1, chain_max));
+
+	add_vertices(res, 1, weights, rng);
+	int split = 0;
+	while (res.n_vertices() < n)
+	{
+		vector<int> ends;
+		int n_chains = fan(rng);
+		for (int c = 0; c < n_chains; ++c)
+		{
+			int prev = split;
+			int length = chain(rng);
+			for (int t = 0; t < length; ++t)
+			{
+				add_vertices(res, 1, weights, rng);
+				add_edge(res, prev, res.n_vertices() - 1, weights, rng);
+				prev = res.n_vertices() - 1;
+			}
+			ends.push_back(prev);
+		}
+
+		add_vertices(res, 1, weights, rng);
+		int join = res.n_vertices() - 1;
+		for (int end : ends)
+			add_edge(res, end, join, weights, rng);
+		split = join;
+	}
+
+	return convert_to_SimpleDataFlow(res);
+}
+
+/* @return the seed of instance k of a series (splitmix64 of seed and k)
+ */
+uint64_t instance_seed(uint64_t seed, uint64_t k)
+{
+	uint64_t z = seed + (k + 1) * 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/* Generates a series of instances in parallel.
+ * Instance k is model(rng) with rng seeded by instance_seed(seed, k), whatever the number of threads.
+ *
+ * @param count 	Number of instances
+ * @param seed 		Seed of the series
+ * @param model 	Generator of one instance
+ * @param n_threads Number of threads, <= 0 for one per hardware thread
+ */
+vector<Graph> generate_instances(int count, uint64_t seed,
+		const function<Graph(mt19937_64 &rng)> &model, int n_threads /*= 0*/)
+{
+	vector<Graph> res(count);
+	vector<function<void()>> tasks;
+	for (int k = 0; k < count; ++k)
+	{
+		tasks.push_back([&res, &model, seed, k]()
+		{
+			mt19937_64 rng(instance_seed(seed, k));
+			res[k] = model(rng);
+		});
+	}
+	run_tasks(tasks, n_threads);
+	return res;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "graph.h"
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+/* Seeded random DAG generators
+ *
+ * Each generator draws from its own std::mt19937_64, so an instance only depends on its
+ * seed : instances can be generated in parallel and any of them reproduced alone.
+ * Edges are sampled with geometric skipping (the gap to the next edge is drawn directly),
+ * in time O(n + m) instead of one draw per pair of vertices.
+ * Memory weights of vertices are drawn uniformly in [0, w_max), time weights in [0, t_max)
+ * and memory weights of edges in [0, w_max_edges). As with generate_dag_ss, the DAGs are
+ * converted to SimpleDataFlowModel.
+ */
+
+struct DagWeights
+{
+	double w_max = 1;
+	double t_max = 1;
+	double w_max_edges = 1;
+};
+
+// Same model as generate_dag_ss : each edge (i,j), i < j exists with probability connectedness
+Graph generate_random_dag(int n, double connectedness, const DagWeights &weights, std::mt19937_64 &rng);
+
+// Layers of width vertices, each edge between consecutive layers exists with probability
+// connectedness, and each vertex has at least one predecessor in the previous layer
+Graph generate_layered_dag(int n_layers, int width, double connectedness, const DagWeights &weights, std::mt19937_64 &rng);
+
+// Workflow of n vertices alternating fan-out and fan-in : a vertex starts between 1 and fan_max
+// independent chains of 1 to chain_max tasks, which are joined by the next vertex
+Graph generate_fan_dag(int n, int fan_max, int chain_max, const DagWeights &weights, std::mt19937_64 &rng);
+
+uint64_t instance_seed(uint64_t seed, uint64_t k);
+
+std::vector<Graph> generate_instances(int count, uint64_t seed,
+		const std::function<Graph(std::mt19937_64 &rng)> &model, int n_threads = 0);
@@ -5,8 +5,13 @@
 #include <ctime>
 #include <random>
 #include <sstream>
+#include <algorithm>
+#include <cmath>
+#include "dot.h"
 
+#ifdef WITH_GRAPHVIZ
 #include <gvc.h>
+#endif
 
 using namespace std;
 
@@ -59,18 +64,31 @@ Graph::Graph(const Graph &graph)
 	*this = graph;
 }
 
+/* Deep copy : all the edges are copied in a single block,
+ * then the adjacency lists are redirected to the new edges.
+ */
 Graph& Graph::operator=(const Graph &graph)
 {
-	vertices.clear();
-	for (int i = 0; i < graph.n_vertices(); i++)
-		add_vertex(graph.vertices[i].time, graph.vertices[i].memory);
-	
-	for (auto e : edges)
-		delete e;
+	if (this == &graph) return *this;
 
-	edges.clear();
+	edge_blocks.clear();
+	edge_blocks.emplace_back();
+	edge_blocks.back().reserve(max(graph.n_edges(), 64));
+	for (auto &block : graph.edge_blocks)
+		edge_blocks.back().insert(edge_blocks.back().end(), block.begin(), block.end());
+
+	edges.resize(graph.n_edges());
 	for (int i = 0; i < graph.n_edges(); i++)
-		add_edge(graph.edges[i]->id_from, graph.edges[i]->id_to, graph.edges[i]->weight, graph.edges[i]->red);
+		edges[i] = &edge_blocks.back()[i];
+
+	vertices = graph.vertices;
+	for (auto &v : vertices)
+	{
+		for (auto &e : v.outgoing_edges)
+			e = edges[e->id];
+		for (auto &e : v.incoming_edges)
+			e = edges[e->id];
+	}
 
 	source_id = graph.source_id;
 	target_id = graph.target_id;
@@ -78,11 +96,35 @@ Graph& Graph::operator=(const Graph &graph)
 	return *this;
 }
 
-Graph::~Graph()
+/* Returns a pointer to a new edge in the arena.
+ * A full block is never reallocated, a new block is started instead,
+ * at least as large as all the previous ones together.
+ */
+Edge* Graph::allocate_edge(int id, int from, int to, double weight, bool red)
 {
-	for (auto e : edges)
-		delete e;
-	
+	if (edge_blocks.empty() || edge_blocks.back().size() == edge_blocks.back().capacity())
+	{
+		edge_blocks.emplace_back();
+		edge_blocks.back().reserve(max(n_edges(), 64));
+	}
+	edge_blocks.back().emplace_back(id, from, to, weight, red);
+	return &edge_blocks.back().back();
+}
+
+/* Preallocates room for the given total number of vertices and edges */
+void Graph::reserve(int n_vertices, int n_edges)
+{
+	vertices.reserve(n_vertices);
+	edges.reserve(n_edges);
+
+	int free_slots = 0;
+	if (!edge_blocks.empty())
+		free_slots = edge_blocks.back().capacity() - edge_blocks.back().size();
+	if (n_edges - this->n_edges() > free_slots)
+	{
+		edge_blocks.emplace_back();
+		edge_blocks.back().reserve(n_edges - this->n_edges());
+	}
 }
 
 
@@ -96,7 +138,7 @@ int Graph::add_vertex(double time /*= 0*/, double memory /*= 0*/)
 int Graph::add_edge(int id_from, int id_to, double weight/*=1*/, bool red/*=false*/)
 {
 	int new_id = edges.size();
-	Edge* e = new Edge(new_id, id_from, id_to, weight, red);
+	Edge* e = allocate_edge(new_id, id_from, id_to, weight, red);
 	edges.push_back(e);
 	vertices[id_from].add_out_edge(e); 
 	vertices[id_to  ].add_in_edge(e);
@@ -104,6 +146,7 @@ int Graph::add_edge(int id_from, int id_to, double weight/*=1*/, bool red/*=fals
 }
 
 // chech wether there exists a path from a to b using a DFS
+// For many queries on the same DAG, build a ReachabilityIndex (reach.h) instead
 bool Graph::path_exists(int a, int b)
 {
 	vector<bool> seen(n_vertices());
@@ -225,8 +268,9 @@ void Graph::write_to_file(string filename)
 Graph convert_to_SimpleDataFlow(const Graph &graph)
 {
 	Graph res;
-	map<int,pair<int,int>> old_new_id_map; // Maps each old vertex to the endpoints 
-										   // of the corresponding edge in the new graph
+	res.reserve(2 * graph.n_vertices(), graph.n_vertices() + graph.n_edges());
+	vector<pair<int,int>> old_new_id_map(graph.n_vertices()); // Maps each old vertex to the endpoints 
+															  // of the corresponding edge in the new graph
 	int idf, idt;
 	double w;
 	// create all vertices
@@ -299,6 +343,105 @@ Graph generate_dag_ss(int n, double connectedness, double w_max, double t_max, d
 }
 
 /* Read a graph in dot file from a file.
+ * 
+ * This functions assumes that the name of each node can be cast into an integer.
+ * If a label is the empty string, it is ignored.
+ * The file is read by the native parser of dot.h, vertices and edges are numbered
+ * in the same order as with the Graphviz reader.
+ *
+ * @param filename			Name of the file to read the graph from
+ * @param time_label 		Name of the dot propery that contains the time weight of the nodes
+ * @param weight_label 		Name of the dot propery that contains the memory weight of the nodes and edges
+ * @param computation_label Name of the dot propery that contains the information on wether an edge is a computation edge
+ *
+ * @return parsed graph
+ */
+Graph read_graph_from_file(string filename, string time_label, string weight_label, string computation_label)
+{
+	DotReader reader({time_label, weight_label}, {weight_label, computation_label});
+	reader.read(filename);
+
+	double w, t, tmp;
+	bool r;
+
+	Graph res;
+	res.reserve(reader.n_nodes(), reader.n_edges());
+	for (int i = 0; i < reader.n_nodes(); ++i)
+	{
+		// Get time info
+		tmp = reader.node_value(i, 0);
+		t = (isnan(tmp)) ? 0 : tmp;
+
+		// Get weight info
+		tmp = reader.node_value(i, 1);
+		w = (isnan(tmp)) ? 0 : tmp;
+
+		res.add_vertex(t, w);
+	}
+
+	for (int i = 0; i < reader.n_edges(); ++i)
+	{
+		// Get weight info
+		tmp = reader.edge_value(i, 0);
+		w = (isnan(tmp)) ? 0 : tmp;
+
+		// Get color info
+		tmp = reader.edge_value(i, 1);
+		r = !isnan(tmp) && (int)tmp != 0;
+
+		res.add_edge(reader.edge_from[i], reader.edge_to[i], w, r);
+	}
+
+	res.find_source();
+	res.find_target();
+
+	return res;
+}
+
+/* Read a Pegasus workflow, already in SDFM, from a dot file
+ * An edge is a computation (red) edge if its head has a null time and an even name.
+ */
+Graph read_graph_from_pegasus(string filename, string time_label, string weight_label)
+{
+	DotReader reader({time_label}, {weight_label});
+	reader.read(filename);
+
+	double w = 0, t = 0;
+	bool r = false;
+
+	Graph res;
+	res.reserve(reader.n_nodes(), reader.n_edges());
+	// Parse nodes : these graphs are already in SDFM, don't care about their weight
+	for (int i = 0; i < reader.n_nodes(); ++i)
+		res.add_vertex(0, 0);
+
+	for (int i = 0; i < reader.n_edges(); ++i)
+	{
+		int a = reader.edge_from[i];
+		int b = reader.edge_to[i];
+
+		// Get weight info
+		w = reader.edge_value(i, 0);
+		if (isnan(w))
+			w = 0;
+
+		t = reader.node_value(b, 0);
+		if (isnan(t))
+			t = 1;
+
+		r = (abs(t) < 1e-6) && (reader.node_names[b]%2 == 0);
+		
+		res.add_edge(a, b, w, r);
+	}
+
+	res.find_source();
+	res.find_target();
+
+	return res;
+}
+
+#ifdef WITH_GRAPHVIZ
+/* Same as read_graph_from_file, using the Graphviz library to parse the file.
  * 
  * This functions assumes that the "agnameof(n)" (that is, the name of each node) can be cast into an integer.
  * If that's not the case, transform the map into a <string, int> map, and use the agnameof without casting it.
@@ -311,7 +454,7 @@ Graph generate_dag_ss(int n, double connectedness, double w_max, double t_max, d
  *
  * @return parsed graph
  */
-Graph read_graph_from_file(string filename, string time_label, string weight_label, string computation_label)
+Graph read_graph_from_file_cgraph(string filename, string time_label, string weight_label, string computation_label)
 {
 	Agraph_t *g;
 	FILE *f = fopen(filename.c_str(), "r");
@@ -371,4 +514,5 @@ Graph read_graph_from_file(string filename, string time_label, string weight_lab
 	agclose(g);
 	fclose(f);
 	return res;
-}  
+}
+#endif
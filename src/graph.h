@@ -45,11 +45,16 @@ public:
 
 /* Class for directed graphs
  * 
+ * The edges are owned by the graph and allocated in a few large blocks (arena) :
+ * pointers to edges stay valid when edges are added, moving a graph is O(1) and
+ * copying it copies all the edges at once.
  */
 class Graph
 {
 private:
+	std::vector<std::vector<Edge>> edge_blocks;
 
+	Edge* allocate_edge(int id, int from, int to, double weight, bool red);
 
 public:
 	std::vector<Edge*> edges;
@@ -57,9 +62,10 @@ public:
 	
 	Graph();
 	Graph(const Graph &graph);
-	~Graph();
+	Graph(Graph &&graph) = default;
 
 	Graph& operator=(const Graph &graph);
+	Graph& operator=(Graph &&graph) = default;
 
 	int source_id, target_id; // -1 if not set
 	int find_source();
@@ -69,6 +75,7 @@ public:
 
 	int add_vertex(double time = 0, double memory = 0);
 	int add_edge(int id_from, int id_to, double weight = 0, bool red = false);
+	void reserve(int n_vertices, int n_edges);
 	void make_single_source_target();
 	void write_to_file(std::string filename);
 	std::string to_string();
@@ -87,5 +94,9 @@ public:
 
 
 Graph read_graph_from_file(std::string filename, std::string time_label, std::string weight_label, std::string computation_label);
+Graph read_graph_from_pegasus(std::string filename, std::string time_label = "size", std::string weight_label = "size");
+#ifdef WITH_GRAPHVIZ
+Graph read_graph_from_file_cgraph(std::string filename, std::string time_label, std::string weight_label, std::string computation_label);
+#endif
 Graph convert_to_SimpleDataFlow(const Graph &graph);
 Graph generate_dag_ss(int n, double connectedness, double w_max, double t_max, double w_max_edges);
\ No newline at end of file
@@ -0,0 +1,340 @@
+#ifdef WITH_GUROBI
+
+#include "gurobi_c++.h"
+#include "backend.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <limits>
+#include <cmath>
+
+using namespace std;
+
+/* This file contains the Gurobi backend of the p-maxcut LP (built with WITH_GUROBI)
+ */
+
+/* Gurobi model of the p-maxcut LP of a graph.
+ * The model is built once, then only the right hand side of the proc_count <= p_max constraint
+ * (and the type of the variables, for the ILP) changes between two solves, so the solver can
+ * restart from the previous basis.
+ */
+class GurobiBackend : public CutBackend
+{
+private:
+	GRBEnv env;
+	unique_ptr<GRBModel> model;
+	vector<GRBVar> p;
+	GRBConstr proc_count;
+	bool integral;
+	vector<double> lb, ub;	// bounds of the variables
+
+	// Last LP solution, for the ILP
+	int lp_p_max;
+	vector<double> lp_x, lp_rc;
+	double lp_value;
+
+	void set_integral(bool integral);
+
+public:
+	GurobiBackend(const Graph &graph, int n_threads);
+
+	bool supports_integral() const { return true; }
+	int solve(int p_max, bool integral, vector<double> &pi_values, double &bound, SolverStats *stats);
+	int solve_integral(int p_max, const vector<double> &start, double start_value,
+			const AnytimeOptions *options, vector<double> &pi_values, double &bound, SolverStats *stats);
+};
+
+/* Builds the model of the p-maxcut LP of a graph, with source and target set.
+ * Throws a GRBException on error.
+ *
+ * The model is built with the array functions of Gurobi : the objective sum_v c_v p_v
+ * (c_v = weight out of v - weight into v) is given with the variables, p_source and p_target
+ * are fixed by their bounds, and the constraints p_a - p_b >= 0 are added by blocks from the
+ * edge arrays of the CSR graph. Variables are only named with PMAXCUT_DEBUG_NAMES.
+ *
+ * @param n_threads number of threads of the solver, 0 for the solver default
+ */
+GurobiBackend::GurobiBackend(const Graph &graph, int n_threads) : env(true)
+{
+	CSRGraph csr(graph);
+	int n = csr.n_vertices();
+	int m = csr.n_edges();
+
+	env.set("LogFile", "gurobi.log");
+	env.set(GRB_IntParam_OutputFlag, 0);
+	if (n_threads > 0)
+		env.set(GRB_IntParam_Threads, n_threads);
+	env.start();
+	model.reset(new GRBModel(env));
+	integral = false;
+	lp_p_max = -1;
+
+	lb.assign(n, 0.0);
+	ub.assign(n, 1.0);
+	vector<double> obj(n, 0.0), red_coeff(n, 0.0);
+	vector<char> type(n, GRB_CONTINUOUS);
+	int n_red = 0;
+	for (int e = 0; e < m; ++e)
+	{
+		int a = csr.edge_from[e];
+		int b = csr.edge_to[e];
+		obj[a] += csr.weight[e];
+		obj[b] -= csr.weight[e];
+		if (csr.red[e])
+		{
+			red_coeff[a] += 1;
+			red_coeff[b] -= 1;
+			++n_red;
+		}
+	}
+	lb[csr.source_id] = 1;
+	ub[csr.target_id] = 0;
+
+	string *names = nullptr;
+#ifdef PMAXCUT_DEBUG_NAMES
+	vector<string> var_names(n);
+	for (int i = 0; i < n; ++i)
+		var_names[i] = "p_" + to_string(i);
+	names = var_names.data();
+#endif
+
+	GRBModel &mdl = *model;
+	unique_ptr<GRBVar[]> vars(mdl.addVars(lb.data(), ub.data(), obj.data(), type.data(), names, n));
+	p.assign(vars.get(), vars.get() + n);
+	mdl.set(GRB_IntAttr_ModelSense, GRB_MAXIMIZE);
+
+	// proc_count = sum_{(a,b) red} (p_a - p_b), only with the non null coefficients
+	vector<double> coeffs;
+	vector<GRBVar> terms;
+	for (int i = 0; i < n; ++i)
+	{
+		if (red_coeff[i] != 0)
+		{
+			coeffs.push_back(red_coeff[i]);
+			terms.push_back(p[i]);
+		}
+	}
+	GRBLinExpr red_count;
+	red_count.addTerms(coeffs.data(), terms.data(), coeffs.size());
+	proc_count = mdl.addConstr(red_count, GRB_LESS_EQUAL, n_red);
+
+	// p_a - p_b >= 0 for each edge, by blocks to bound the memory of the expressions
+	const int block = 1 << 16;
+	const double unit[2] = {1.0, -1.0};
+	vector<GRBLinExpr> exprs;
+	vector<char> senses(min(m, block), GRB_GREATER_EQUAL);
+	vector<double> rhs(min(m, block), 0.0);
+	for (int first = 0; first < m; first += block)
+	{
+		int count = min(block, m - first);
+		exprs.assign(count, GRBLinExpr());
+		for (int k = 0; k < count; ++k)
+		{
+			GRBVar ends[2] = {p[csr.edge_from[first + k]], p[csr.edge_to[first + k]]};
+			exprs[k].addTerms(unit, ends, 2);
+		}
+		delete[] mdl.addConstrs(exprs.data(), senses.data(), rhs.data(), nullptr, count);
+	}
+}
+
+// Switches the variables between binary and continuous, if needed
+void GurobiBackend::set_integral(bool integral)
+{
+	if (this->integral == integral) return;
+
+	vector<char> type(p.size(), (integral) ? GRB_BINARY : GRB_CONTINUOUS);
+	model->set(GRB_CharAttr_VType, p.data(), type.data(), p.size());
+	this->integral = integral;
+}
+
+int GurobiBackend::solve(int p_max, bool integral, vector<double> &pi_values, double &bound, SolverStats *stats)
+{
+	try
+	{
+		set_integral(integral);
+		proc_count.set(GRB_DoubleAttr_RHS, p_max);
+		model->optimize();
+
+		unique_ptr<double[]> x(model->get(GRB_DoubleAttr_X, p.data(), p.size()));
+		pi_values.assign(x.get(), x.get() + p.size());
+		bound = model->get((integral) ? GRB_DoubleAttr_ObjBound : GRB_DoubleAttr_ObjVal);
+
+		if (!integral)
+		{
+			unique_ptr<double[]> rc(model->get(GRB_DoubleAttr_RC, p.data(), p.size()));
+			lp_rc.assign(rc.get(), rc.get() + p.size());
+			lp_x = pi_values;
+			lp_value = bound;
+			lp_p_max = p_max;
+		}
+
+		if (stats)
+		{
+			stats->iterations = model->get(GRB_DoubleAttr_IterCount);
+			if (integral)
+			{
+				stats->nodes = model->get(GRB_DoubleAttr_NodeCount);
+				stats->mip_gap = model->get(GRB_DoubleAttr_MIPGap);
+			}
+		}
+	}
+	catch (GRBException e)
+	{
+		std::cerr << "GRB Error : " << e.getMessage() <<  e.getErrorCode() << " int ? " << integral << '\n';
+		return 1;
+	}
+	return 0;
+}
+
+// Reports the improving incumbents and bounds of the branch and bound to AnytimeOptions::progress
+class ProgressCallback : public GRBCallback
+{
+private:
+	const AnytimeOptions &options;
+	double incumbent, bound;
+
+public:
+	ProgressCallback(const AnytimeOptions &options) : options(options)
+	{
+		incumbent = -numeric_limits<double>::infinity();
+		bound = numeric_limits<double>::infinity();
+	}
+
+protected:
+	void callback()
+	{
+		double new_incumbent = incumbent, new_bound = bound;
+		if (where == GRB_CB_MIP)
+		{
+			new_incumbent = getDoubleInfo(GRB_CB_MIP_OBJBST);
+			new_bound = getDoubleInfo(GRB_CB_MIP_OBJBND);
+		}
+		else if (where == GRB_CB_MIPSOL)
+		{
+			new_incumbent = getDoubleInfo(GRB_CB_MIPSOL_OBJBST);
+			new_bound = getDoubleInfo(GRB_CB_MIPSOL_OBJBND);
+		}
+		else return;
+
+		if (new_incumbent > incumbent || new_bound < bound)
+		{
+			incumbent = max(incumbent, new_incumbent);
+			bound = min(bound, new_bound);
+			options.progress(incumbent, bound, getDoubleInfo(GRB_CB_RUNTIME));
+		}
+	}
+};
+
+/* Solves the ILP from the LP solution for the same p_max (solved first if needed).
+ * A variable at a bound in the LP, with reduced cost rc, is fixed to that bound if
+ * lp_value - |rc| < start_value - tol : changing it costs at least |rc|, so the cuts where it
+ * changes are strictly worse than the start, which stays feasible (ties, frequent with integer
+ * weights, are not fixed). The start is given to the solver as a MIP start.
+ * The limits of the options are the TimeLimit and NodeLimit of the solver, its progress is
+ * called from a callback. The bounds of the variables and the limits are restored after the solve.
+ */
+int GurobiBackend::solve_integral(int p_max, const vector<double> &start, double start_value,
+		const AnytimeOptions *options, vector<double> &pi_values, double &bound, SolverStats *stats)
+{
+	if (lp_p_max != p_max)
+	{
+		int err = solve(p_max, false, pi_values, bound, nullptr);
+		if (err) return err;
+	}
+
+	int n = p.size();
+	vector<double> fixed_lb(lb), fixed_ub(ub);
+	const double eps = 1e-9;
+	double tol = 1e-6 * max(1.0, fabs(lp_value));
+	for (int i = 0; i < n; ++i)
+	{
+		if (lp_value - fabs(lp_rc[i]) >= start_value - tol) continue;
+		if (lp_x[i] <= eps)
+			fixed_ub[i] = 0;
+		else if (lp_x[i] >= 1 - eps)
+			fixed_lb[i] = 1;
+	}
+
+	bool has_start = start_value > -numeric_limits<double>::infinity();
+	unique_ptr<ProgressCallback> callback;
+	int err = 0;
+	try
+	{
+		set_integral(true);
+		proc_count.set(GRB_DoubleAttr_RHS, p_max);
+		model->set(GRB_DoubleAttr_LB, p.data(), fixed_lb.data(), n);
+		model->set(GRB_DoubleAttr_UB, p.data(), fixed_ub.data(), n);
+		if (has_start)
+			model->set(GRB_DoubleAttr_Start, p.data(), start.data(), n);
+		if (options)
+		{
+			if (options->time_limit > 0)
+				model->set(GRB_DoubleParam_TimeLimit, options->time_limit);
+			if (options->node_limit > 0)
+				model->set(GRB_DoubleParam_NodeLimit, options->node_limit);
+			if (options->progress)
+			{
+				callback.reset(new ProgressCallback(*options));
+				model->setCallback(callback.get());
+			}
+		}
+		model->optimize();
+
+		// At a limit, there may be no solution if the start was rejected
+		if (model->get(GRB_IntAttr_SolCount) > 0)
+		{
+			unique_ptr<double[]> x(model->get(GRB_DoubleAttr_X, p.data(), n));
+			pi_values.assign(x.get(), x.get() + n);
+		}
+		else
+			pi_values = (has_start) ? start : vector<double>(n, 0);
+		bound = model->get(GRB_DoubleAttr_ObjBound);
+		if (stats)
+		{
+			stats->iterations += model->get(GRB_DoubleAttr_IterCount);
+			stats->nodes = model->get(GRB_DoubleAttr_NodeCount);
+		}
+	}
+	catch (GRBException e)
+	{
+		std::cerr << "GRB Error : " << e.getMessage() <<  e.getErrorCode() << '\n';
+		err = 1;
+	}
+
+	try
+	{
+		model->set(GRB_DoubleAttr_LB, p.data(), lb.data(), n);
+		model->set(GRB_DoubleAttr_UB, p.data(), ub.data(), n);
+		if (options)
+		{
+			model->set(GRB_DoubleParam_TimeLimit, GRB_INFINITY);
+			model->set(GRB_DoubleParam_NodeLimit, GRB_INFINITY);
+			model->setCallback(nullptr);
+		}
+	}
+	catch (GRBException e)
+	{
+		std::cerr << "GRB Error : " << e.getMessage() <<  e.getErrorCode() << '\n';
+		err = 1;
+	}
+	return err;
+}
+
+/* @return the Gurobi backend of a graph with source and target set, or null if there was an error in gurobi
+ */
+unique_ptr<CutBackend> make_gurobi_backend(const Graph &graph, int n_threads)
+{
+	try
+	{
+		return unique_ptr<CutBackend>(new GurobiBackend(graph, n_threads));
+	}
+	catch (GRBException e)
+	{
+		std::cerr << "GRB Error : " << e.getMessage() << '\n';
+		return nullptr;
+	}
+}
+
+#endif // WITH_GUROBI
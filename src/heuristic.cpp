@@ -0,0 +1,400 @@
+#include "pmaxcut.h"
+#include "csr.h"
+#include "runner.h"
+#include "generator.h"
+#include <vector>
+#include <deque>
+#include <queue>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+/* This file contains the primal heuristic of the p-maxcut, for graphs too large for the ILP
+ */
+
+// Bounds of the ancestor (or descendant) closed sets moved by the local search
+static const int MAX_SET_SIZE = 64;
+static const int MAX_SET_ARCS = 1024;
+
+/* Local search on the topological cuts of a graph.
+ *
+ * A topological cut is a set S closed under predecessors. With c_v the weight out of v minus
+ * the weight into v, and r_v the same for the number of red edges, the weight of the cut is
+ * sum_{v in S} c_v and its number of red edges sum_{v in S} r_v : the gain of a move does not
+ * depend on the rest of the cut, only whether it keeps S closed does. A vertex of T can join S
+ * when all its predecessors are in S (frontier of T), a vertex of S can leave it when all its
+ * successors are in T (frontier of S) : the number of predecessors in T and of successors in S
+ * of each vertex are updated at each move.
+ */
+class CutSearch
+{
+private:
+	const CSRGraph &graph;
+	const vector<double> &c;
+	const vector<int> &r;
+	int p_max;
+	double tol;
+
+	vector<bool> in_S;
+	vector<int> preds_T, succs_S;
+	vector<int> stamp;	// last closure that reached each vertex
+	int time;
+
+	void add(int v);
+	void remove(int v);
+	bool closure(int v, vector<int> &set);
+
+	inline bool frontier_T(int v) const
+	{
+		return !in_S[v] && preds_T[v] == 0 && v != graph.target_id;
+	}
+
+public:
+	double value;
+	int red;
+
+	CutSearch(const CSRGraph &graph, const vector<double> &c, const vector<int> &r, int p_max, double tol,
+			const vector<int> &initial);
+
+	void greedy(double lambda, double noise, mt19937_64 &rng);
+	void local_search(mt19937_64 &rng, long max_pops);
+
+	inline bool feasible() const
+	{
+		return red <= p_max;
+	}
+
+	inline bool contains(int v) const
+	{
+		return in_S[v];
+	}
+};
+
+// S starts with the given vertices, which must be closed under predecessors
+CutSearch::CutSearch(const CSRGraph &graph, const vector<double> &c, const vector<int> &r, int p_max, double tol,
+		const vector<int> &initial)
+	: graph(graph), c(c), r(r), p_max(p_max), tol(tol)
+{
+	int n = graph.n_vertices();
+	in_S.assign(n, false);
+	preds_T.resize(n);
+	for (int v = 0; v < n; ++v)
+		preds_T[v] = graph.in_degree(v);
+	succs_S.assign(n, 0);
+	stamp.assign(n, 0);
+	time = 0;
+	value = 0;
+	red = 0;
+	for (int v : initial)
+		add(v);
+}
+
+void CutSearch::add(int v)
+{
+	in_S[v] = true;
+	value += c[v];
+	red += r[v];
+	for (uint32_t k = graph.out_offsets[v]; k < graph.out_offsets[v + 1]; ++k)
+		--preds_T[graph.out_heads[k]];
+	for (uint32_t k = graph.in_offsets[v]; k < graph.in_offsets[v + 1]; ++k)
+		++succs_S[graph.in_tails[k]];
+}
+
+void CutSearch::remove(int v)
+{
+	in_S[v] = false;
+	value -= c[v];
+	red -= r[v];
+	for (uint32_t k = graph.out_offsets[v]; k < graph.out_offsets[v + 1]; ++k)
+		++preds_T[graph.out_heads[k]];
+	for (uint32_t k = graph.in_offsets[v]; k < graph.in_offsets[v + 1]; ++k)
+		--succs_S[graph.in_tails[k]];
+}
+
+/* Greedy construction from the frontier of T : the vertex of the frontier with the best score
+ * c_v - lambda r_v (multiplied by a random factor in [1 - noise, 1 + noise]) joins S, while the
+ * score is positive or the cut has too many red edges. When the cut has at most p_max red edges,
+ * the vertices that would exceed it are skipped. S is then brought back to the best cut with at
+ * most p_max red edges of the construction (unchanged if there is none).
+ */
+void CutSearch::greedy(double lambda, double noise, mt19937_64 &rng)
+{
+	uniform_real_distribution<double> factor(1 - noise, 1 + noise);
+	priority_queue<pair<double,int>> frontier;
+	auto push = [&](int v)
+	{
+		frontier.push(make_pair((c[v] - lambda * r[v]) * factor(rng), v));
+	};
+	for (int v = 0; v < graph.n_vertices(); ++v)
+	{
+		if (frontier_T(v))
+			push(v);
+	}
+
+	vector<int> added;
+	size_t best_size = 0;
+	double best_value = (feasible()) ? value : -numeric_limits<double>::infinity();
+	while (!frontier.empty())
+	{
+		double score = frontier.top().first;
+		int v = frontier.top().second;
+		if (score <= 0 && feasible()) break;
+		frontier.pop();
+		// v is pushed once per edge that made it join the frontier (parallel edges)
+		if (in_S[v]) continue;
+		if (feasible() && red + r[v] > p_max) continue;
+
+		add(v);
+		added.push_back(v);
+		for (uint32_t k = graph.out_offsets[v]; k < graph.out_offsets[v + 1]; ++k)
+		{
+			if (frontier_T(graph.out_heads[k]))
+				push(graph.out_heads[k]);
+		}
+		if (feasible() && value > best_value + tol)
+		{
+			best_value = value;
+			best_size = added.size();
+		}
+	}
+
+	while (added.size() > best_size)
+	{
+		remove(added.back());
+		added.pop_back();
+	}
+}
+
+/* Smallest set that moves v to the other side of the cut and keeps S closed : v and its
+ * ancestors in T if v is in T, v and its descendants in S otherwise.
+ *
+ * @return false if the set would contain the target (or the source), or is too large
+ */
+bool CutSearch::closure(int v, vector<int> &set)
+{
+	bool up = !in_S[v];
+	int forbidden = (up) ? graph.target_id : graph.source_id;
+	const uint32_t *offsets = (up) ? graph.in_offsets : graph.out_offsets;
+	const uint32_t *ends = (up) ? graph.in_tails : graph.out_heads;
+
+	++time;
+	set.clear();
+	set.push_back(v);
+	stamp[v] = time;
+	int arcs = 0;
+	for (size_t i = 0; i < set.size(); ++i)
+	{
+		int u = set[i];
+		if (u == forbidden) return false;
+		arcs += offsets[u + 1] - offsets[u];
+		if (arcs > MAX_SET_ARCS) return false;
+		for (uint32_t k = offsets[u]; k < offsets[u + 1]; ++k)
+		{
+			int w = ends[k];
+			if (in_S[w] == up || stamp[w] == time) continue;
+			stamp[w] = time;
+			set.push_back(w);
+			if (set.size() > (size_t)MAX_SET_SIZE) return false;
+		}
+	}
+	return true;
+}
+
+/* Moves closed sets across the cut while it improves its weight and keeps at most p_max red
+ * edges. The vertices are tried in random order, then again when a neighbour moved, at most
+ * max_pops times in total.
+ */
+void CutSearch::local_search(mt19937_64 &rng, long max_pops)
+{
+	int n = graph.n_vertices();
+	vector<int> order(n);
+	iota(order.begin(), order.end(), 0);
+	shuffle(order.begin(), order.end(), rng);
+	deque<int> queue(order.begin(), order.end());
+	vector<bool> queued(n, true);
+
+	vector<int> set;
+	for (long pops = 0; !queue.empty() && pops < max_pops; ++pops)
+	{
+		int v = queue.front();
+		queue.pop_front();
+		queued[v] = false;
+
+		bool up = !in_S[v];
+		if (!closure(v, set)) continue;
+		double gain = 0;
+		int red_gain = 0;
+		for (int u : set)
+		{
+			gain += c[u];
+			red_gain += r[u];
+		}
+		if (!up)
+		{
+			gain = -gain;
+			red_gain = -red_gain;
+		}
+		if (gain <= tol || red + red_gain > p_max) continue;
+
+		for (int u : set)
+		{
+			if (up)
+				add(u);
+			else
+				remove(u);
+		}
+		auto enqueue = [&](int w)
+		{
+			if (!queued[w])
+			{
+				queued[w] = true;
+				queue.push_back(w);
+			}
+		};
+		for (int u : set)
+		{
+			for (uint32_t k = graph.out_offsets[u]; k < graph.out_offsets[u + 1]; ++k)
+				enqueue(graph.out_heads[k]);
+			for (uint32_t k = graph.in_offsets[u]; k < graph.in_offsets[u + 1]; ++k)
+				enqueue(graph.in_tails[k]);
+		}
+	}
+}
+
+/**
+ * @private
+ *  Find a good topological cut with at most p_max red edges, for graphs too large for the ILP.
+ *  Its weight is a lower bound of the p-maxcut : with an upper bound (e.g. the bound of
+ *  get_p_maxcut_lagrangian), it gives an interval of the optimal value.
+ *
+ *  Each restart builds a cut greedily from the frontier of T (see CutSearch::greedy), then
+ *  improves it by local search, moving single vertices or their closed sets of ancestors or
+ *  descendants (at most 64 vertices) across the cut. Restart k has its own generator, seeded with
+ *  instance_seed(seed, k), and a multiplier of the red edges in the greedy score that grows with k
+ *  (0 for the first restart, without noise). The restarts run in parallel, and the best cut is
+ *  kept (the first restart in case of a tie) : the result only depends on the seed.
+ *  About O((n + m) log n) time per restart.
+ *
+ * @param graph		the DAG in Graph format
+ * @param p_max		value of p
+ * @param cut 		vector that will contain the edges of the cut
+ * @param S 		vector that will contain the S set after the cut
+ * @param T			vector that will contain the T set after the cut
+ * @param res 		double where the weight of the cut will be stored
+ * @param n_restarts 	number of restarts
+ * @param seed 		seed of the restarts
+ * @param n_threads Number of threads, <= 0 for one per hardware thread
+ *
+ *
+ * @return 0 if everything went well, 2 if no restart found a cut with at most p_max red edges,
+ *  3 if the source or the target are not set.
+ */
+int get_p_maxcut_heuristic(const Graph &graph, int p_max,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res,
+		int n_restarts, uint64_t seed, int n_threads)
+{
+	int source = graph.source_id, target = graph.target_id;
+	if (source == -1 || target == -1) return 3;
+
+	cut.clear();
+	S.clear();
+	T.clear();
+	res = -1;
+
+	CSRGraph csr(graph);
+	int n = csr.n_vertices();
+	vector<double> c(n, 0);
+	vector<int> r(n, 0);
+	double positive = 0, largest = 0;
+	int n_red = 0;
+	for (int e = 0; e < csr.n_edges(); ++e)
+	{
+		c[csr.edge_from[e]] += csr.weight[e];
+		c[csr.edge_to[e]] -= csr.weight[e];
+		r[csr.edge_from[e]] += csr.red[e];
+		r[csr.edge_to[e]] -= csr.red[e];
+		n_red += csr.red[e];
+	}
+	for (int v = 0; v < n; ++v)
+	{
+		positive += max(c[v], 0.0);
+		largest = max(largest, fabs(c[v]));
+	}
+	// Relative to the largest |c_v|, as in max_closure
+	double tol = 1e-12 * max(1.0, largest);
+
+	// The source and its ancestors are in all the cuts
+	vector<int> initial(1, source);
+	vector<bool> seen(n, false);
+	seen[source] = true;
+	for (size_t i = 0; i < initial.size(); ++i)
+	{
+		int v = initial[i];
+		if (v == target) return 2;
+		for (uint32_t k = csr.in_offsets[v]; k < csr.in_offsets[v + 1]; ++k)
+		{
+			int u = csr.in_tails[k];
+			if (!seen[u])
+			{
+				seen[u] = true;
+				initial.push_back(u);
+			}
+		}
+	}
+
+	// Scale of the multiplier : average positive weight per red edge
+	double lambda_scale = positive / max(1, n_red);
+	long max_pops = 4 * ((long)n + csr.n_edges());
+
+	n_restarts = max(1, n_restarts);
+	vector<vector<bool>> best_S(n_restarts);
+	vector<double> values(n_restarts, -numeric_limits<double>::infinity());
+	vector<function<void()>> tasks;
+	for (int k = 0; k < n_restarts; ++k)
+	{
+		tasks.push_back([&, k]()
+		{
+			mt19937_64 rng(instance_seed(seed, k));
+			double lambda = lambda_scale * 2.0 * k / n_restarts;
+			double noise = (k == 0) ? 0 : 0.25;
+
+			CutSearch search(csr, c, r, p_max, tol, initial);
+			search.greedy(lambda, noise, rng);
+			if (!search.feasible()) return;
+			search.local_search(rng, max_pops);
+
+			values[k] = search.value;
+			best_S[k].resize(n);
+			for (int v = 0; v < n; ++v)
+				best_S[k][v] = search.contains(v);
+		});
+	}
+	run_tasks(tasks, n_threads);
+
+	int best = max_element(values.begin(), values.end()) - values.begin();
+	if (values[best] == -numeric_limits<double>::infinity()) return 2;
+
+	// The weight is summed again in the order of the edges
+	const vector<bool> &in_S = best_S[best];
+	res = 0;
+	for (auto e : graph.edges)
+	{
+		if (in_S[e->id_from] && !in_S[e->id_to])
+		{
+			res += e->weight;
+			cut.push_back(e->id);
+		}
+	}
+	for (int v = 0; v < n; ++v)
+	{
+		if (in_S[v])
+			S.push_back(v);
+		else
+			T.push_back(v);
+	}
+	return 0;
+}
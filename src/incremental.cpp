@@ -0,0 +1,257 @@
+#include "incremental.h"
+#include "maxflow.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+/* This file contains the maxcut under edits of the graph
+ */
+
+int IncrementalMaxcut::add_arc(int from, int to, double capacity)
+{
+	int new_id = head.size();
+	head.push_back(to);
+	residual.push_back(capacity);
+	head.push_back(from);
+	residual.push_back(0);
+	out[from].push_back(new_id);
+	out[to].push_back(new_id^1);
+	return new_id;
+}
+
+/* Computes the maxcut of a DAG with source and target set, with a max-flow,
+ * and builds the search tree of the residual network.
+ */
+IncrementalMaxcut::IncrementalMaxcut(const Graph &graph)
+{
+	n = graph.n_vertices();
+	s = n;
+	t = n + 1;
+	out.resize(n + 2);
+	c.assign(n, 0);
+
+	for (auto e : graph.edges)
+	{
+		edge_from.push_back(e->id_from);
+		edge_to.push_back(e->id_to);
+		edge_weight.push_back(e->weight);
+		c[e->id_from] += e->weight;
+		c[e->id_to]   -= e->weight;
+	}
+	// Relative to the largest capacity, as in max_closure
+	double largest = 0;
+	for (int v = 0; v < n; ++v)
+		largest = max(largest, fabs(c[v]));
+	tol = 1e-12 * max(1.0, largest);
+
+	// Same network as max_closure, with both terminal arcs for all the vertices
+	const double inf = numeric_limits<double>::infinity();
+	MaxFlow network(n + 2);
+	network.tolerance = tol;
+	auto arc = [&](int from, int to, double capacity)
+	{
+		network.add_arc(from, to, capacity);
+		return add_arc(from, to, capacity);
+	};
+	for (int v = 0; v < n; ++v)
+	{
+		source_arc.push_back(arc(s, v, max(c[v], 0.0)));
+		sink_arc.push_back(arc(v, t, max(-c[v], 0.0)));
+	}
+	arc(s, graph.source_id, inf);
+	arc(graph.target_id, t, inf);
+	for (size_t e = 0; e < edge_from.size(); ++e)
+		arc(edge_to[e], edge_from[e], inf);
+
+	network.run(s, t);
+	for (size_t a = 0; a < residual.size(); ++a)
+		residual[a] = network.residual(a);
+
+	in_tree.assign(n + 2, false);
+	parent.assign(n + 2, -1);
+	stamp.assign(n + 2, 0);
+	time = 0;
+	cut_value = 0;
+	next_candidate = 0;
+
+	in_tree[s] = true;
+	for (int a : out[s])
+		candidates.push_back(a);
+	repair();
+}
+
+// Adds delta to c_v, by increasing the capacity of one of the terminal arcs of v
+void IncrementalMaxcut::change_c(int v, double delta)
+{
+	c[v] += delta;
+	tol = max(tol, 1e-12 * fabs(c[v]));
+	if (in_tree[v])
+		cut_value += delta;
+
+	int a = (delta > 0) ? source_arc[v] : sink_arc[v];
+	residual[a] += fabs(delta);
+	candidates.push_back(a);
+}
+
+/* Adds an edge to the graph, the graph must stay acyclic
+ *
+ * @return the id of the new edge
+ */
+int IncrementalMaxcut::add_edge(int from, int to, double weight)
+{
+	edge_from.push_back(from);
+	edge_to.push_back(to);
+	edge_weight.push_back(0);
+
+	// If to is in S, then from must be in S
+	candidates.push_back(add_arc(to, from, numeric_limits<double>::infinity()));
+	set_weight(edge_weight.size() - 1, weight);
+	return edge_weight.size() - 1;
+}
+
+void IncrementalMaxcut::set_weight(int edge, double weight)
+{
+	double delta = weight - edge_weight[edge];
+	edge_weight[edge] = weight;
+	if (delta != 0)
+	{
+		change_c(edge_from[edge], delta);
+		change_c(edge_to[edge], -delta);
+	}
+	repair();
+}
+
+void IncrementalMaxcut::attach(int v, int arc)
+{
+	in_tree[v] = true;
+	parent[v] = arc;
+	if (v < n)
+		cut_value += c[v];
+	for (int a : out[v])
+		candidates.push_back(a);
+}
+
+/* Grows the tree from the candidate arcs, until no residual arc leaves the tree.
+ * Then the tree is the S side of a minimum cut of the network.
+ */
+void IncrementalMaxcut::repair()
+{
+	while (next_candidate < candidates.size())
+	{
+		int a = candidates[next_candidate++];
+		int u = tail(a), v = head[a];
+		if (!in_tree[u] || in_tree[v] || residual[a] <= tol) continue;
+
+		if (v == t)
+			augment(a);
+		else
+			attach(v, a);
+	}
+	candidates.clear();
+	next_candidate = 0;
+}
+
+// Augments the flow along the path of the tree to the tail of last_arc, then last_arc
+void IncrementalMaxcut::augment(int last_arc)
+{
+	double delta = residual[last_arc];
+	for (int v = tail(last_arc); v != s; v = tail(parent[v]))
+		delta = min(delta, residual[parent[v]]);
+
+	residual[last_arc] -= delta;
+	residual[last_arc^1] += delta;
+	for (int v = tail(last_arc); v != s; v = tail(parent[v]))
+	{
+		int a = parent[v];
+		residual[a] -= delta;
+		residual[a^1] += delta;
+		if (residual[a] <= tol)
+			orphans.push_back(v);
+	}
+	for (int v : orphans)
+		parent[v] = -1;
+
+	// The tail may still reach t through last_arc, if it is still in the tree
+	if (residual[last_arc] > tol)
+		candidates.push_back(last_arc);
+	adopt();
+}
+
+// True iff the path of parents from v reaches the root (no orphan on the way)
+bool IncrementalMaxcut::rooted(int v)
+{
+	int u = v;
+	while (u != s && stamp[u] != time)
+	{
+		if (parent[u] == -1) return false;
+		u = tail(parent[u]);
+	}
+	for (u = v; u != s && stamp[u] != time; u = tail(parent[u]))
+		stamp[u] = time;
+	return true;
+}
+
+/* Re-attaches each orphan to a vertex of the tree through a residual arc,
+ * or removes it from the tree, its children becoming orphans.
+ */
+void IncrementalMaxcut::adopt()
+{
+	++time;
+	while (!orphans.empty())
+	{
+		int v = orphans.back();
+		orphans.pop_back();
+
+		for (int a : out[v])
+		{
+			int u = head[a];
+			if (in_tree[u] && residual[a^1] > tol && rooted(u))
+			{
+				parent[v] = a^1;
+				stamp[v] = time;
+				break;
+			}
+		}
+		if (parent[v] != -1) continue;
+
+		in_tree[v] = false;
+		if (v < n)
+			cut_value -= c[v];
+		for (int a : out[v])
+		{
+			int u = head[a];
+			if (!in_tree[u]) continue;
+			if (parent[u] == a)
+			{
+				parent[u] = -1;
+				orphans.push_back(u);
+			}
+			// u may grow back to v
+			if (residual[a^1] > tol)
+				candidates.push_back(a^1);
+		}
+	}
+}
+
+/* Same outputs as get_maxcut_flow, in time O(n + m)
+ */
+void IncrementalMaxcut::get_cut(vector<int> &cut, vector<int> &S, vector<int> &T) const
+{
+	cut.clear();
+	S.clear();
+	T.clear();
+	for (size_t e = 0; e < edge_from.size(); ++e)
+	{
+		if (in_tree[edge_from[e]] && !in_tree[edge_to[e]])
+			cut.push_back(e);
+	}
+	for (int v = 0; v < n; ++v)
+	{
+		if (in_tree[v])
+			S.push_back(v);
+		else
+			T.push_back(v);
+	}
+}
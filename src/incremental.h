@@ -0,0 +1,82 @@
+#pragma once
+
+#include "graph.h"
+#include <vector>
+
+/* Maximum topological cut of a DAG under edits (same value as get_maxcut_flow)
+ *
+ * The cut is the maximum weight closure of the vertices (see flowcut.cpp) : the flow network
+ * has an arc s -> v of capacity c_v or v -> t of capacity -c_v, with c_v the weight out of v
+ * minus the weight into v, and an infinite arc b -> a for each edge (a, b).
+ * The flow is kept between two edits, and so is the search tree of the residual network
+ * rooted at s, whose vertices are the S side of the cut.
+ *
+ * An edit only increases capacities : when c_v increases, the capacity of s -> v increases,
+ * when it decreases, the capacity of v -> t increases (adding the same amount to both arcs
+ * of v adds a constant to all the cuts, the flow stays feasible). The tree is then grown from
+ * the arcs that changed. When it reaches t, the flow is augmented along the path, and the
+ * vertices below the saturated arcs are re-attached to the tree, or removed from it with their
+ * subtree (as in the Boykov-Kolmogorov algorithm).
+ * The work is proportional to the vertices that change sides, their arcs and the augmenting
+ * paths, not to the size of the graph.
+ *
+ * In SimpleDataFlowModel, the memory of a task is the weight of an edge : it is changed with
+ * set_weight.
+ */
+class IncrementalMaxcut
+{
+private:
+	int n;			// vertices of the graph, s = n and t = n + 1 in the network
+	int s, t;
+	double tol;		// residual capacities below this value are considered as 0 (relative to the largest |c_v| so far)
+
+	std::vector<int> head;			// head of each arc of the network, the reverse of arc a is a^1
+	std::vector<double> residual;
+	std::vector<std::vector<int>> out;	// arcs leaving each node, with the reverse arcs
+	std::vector<int> source_arc, sink_arc;	// arcs s -> v and v -> t of each vertex
+
+	std::vector<int> edge_from, edge_to;
+	std::vector<double> edge_weight;
+	std::vector<double> c;			// weight out of v minus weight into v
+
+	std::vector<bool> in_tree;		// S side
+	std::vector<int> parent;		// arc from the parent in the tree, -1 for the root and the orphans
+	std::vector<int> stamp;			// last adoption in which the vertex was found attached to the root
+	int time;
+	double cut_value;
+
+	std::vector<int> candidates;	// arcs that may extend the tree
+	size_t next_candidate;
+	std::vector<int> orphans;
+
+	int add_arc(int from, int to, double capacity);
+	void change_c(int v, double delta);
+	void repair();
+	void attach(int v, int arc);
+	void augment(int last_arc);
+	bool rooted(int v);
+	void adopt();
+
+	inline int tail(int arc) const
+	{
+		return head[arc^1];
+	}
+
+public:
+	IncrementalMaxcut(const Graph &graph);
+
+	int add_edge(int from, int to, double weight);
+	void set_weight(int edge, double weight);
+
+	inline double value() const
+	{
+		return cut_value;
+	}
+
+	inline bool in_S(int v) const
+	{
+		return in_tree[v];
+	}
+
+	void get_cut(std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T) const;
+};
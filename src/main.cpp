@@ -4,13 +4,36 @@
 
 #include "graph.h"
 #include "pmaxcut.h"
-#include <gvc.h>
-#include <map>
+#include "cache.h"
+#include "runner.h"
+#include "results.h"
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <memory>
+#include <cmath>
 
 namespace fs = std::experimental::filesystem;
 using namespace std;
 
-Graph read_graph_from_pegasus(string filename, string time_label="size", string weight_label="size");
+/* Timings and sizes of the reading of a graph */
+struct ReadStats
+{
+	double read_time = 0;		// parsing, or loading of the cache entry (s)
+	double convert_time = 0;	// conversion to SDFM (s)
+	long n_raw = -1, m_raw = -1;	// size before the conversion, -1 if unknown (cache hit)
+};
+
+Graph read_graph_cached(string filename, bool convert, ReadStats *stats = nullptr);
+
+// Time in seconds, for the statistics
+static double wall_time()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Directory of the binary graph cache, cache entries are written next to the dot files if empty
+string graph_cache_dir = "./.graph_cache";
 
 /* Compares the value of the maxcut, p-maxcut and an approximation of the p-maxcut
  * on N randomly generated DAGs
@@ -28,7 +51,7 @@ void test_n_random(int N, int n_vtx, double connectedness, double w_max, double
 		
 		cerr << test.to_string() << endl;
 
-		int err = get_maxcut_lin(test, cut, s, t, maxcut);
+		int err = get_maxcut_flow(test, cut, s, t, maxcut);
 		if (err && disp_err)
 			cout << " Error in maxcut !" << endl;
 
@@ -70,151 +93,423 @@ void test_n_random(int N, int n_vtx, double connectedness, double w_max, double
 	if (disp_err) cout << "Failures : " << failures << " out of " << N << endl;
 }
 
-/* Compares the value of the maxcut, p-maxcut and an approximation of the p-maxcut
- * for all the files (assumed to be correctly formatted dot files) in the folder
- * pointed by path.
- * For example files, see the subfolders of the test folder of this project.
+/* Checks get_p_maxcut_heuristic on N small random DAGs with parallel edges (copies of some
+ * edges, as kept by the dot parser for non strict graphs) : its S set must be a topological cut
+ * with at most p red edges, of weight res, and res must be at most the p-maxcut, found by
+ * enumerating the subsets of the vertices.
  *
- * @param path Path of the folder to test
- * @param p Value of p for the tests
+ * @return the number of failures
  */
-void test_folder_pegasus(string path, int p)
+int check_heuristic_random(int N, int p)
 {
-	cout << "Folder " << path << " " << p << " MAXCUT LP ILP" << endl;
-
 	int failures = 0;
-	int c = 0;
-    for (const auto &entry : fs::directory_iterator(path))
+	for (int i = 0; i < N; ++i)
 	{
-		Graph test = read_graph_from_pegasus(entry.path());
-
-		vector<int> cut, s, t;
-		double maxcut, LPvalue, ILPvalue;
+		Graph test = generate_dag_ss(2 + random() % 5, 0.5, 500, 0, 500);
+		int m = test.n_edges();
+		for (int e = 0; e < m; ++e)
+		{
+			if (random() % 3 == 0)
+				test.add_edge(test.edges[e]->id_from, test.edges[e]->id_to, (((double)random()) / RAND_MAX) * 500, test.edges[e]->red);
+		}
 
-		int err = get_maxcut_lin(test, cut, s, t, maxcut);
+		int n = test.n_vertices();
+		double optimum = -1;
+		for (long mask = 0; mask < (1L << n); ++mask)
+		{
+			if (!(mask >> test.source_id & 1) || (mask >> test.target_id & 1)) continue;
+			double weight = 0;
+			int red = 0;
+			bool closed = true;
+			for (auto e : test.edges)
+			{
+				bool from_S = mask >> e->id_from & 1, to_S = mask >> e->id_to & 1;
+				closed &= from_S || !to_S;
+				if (from_S && !to_S)
+				{
+					weight += e->weight;
+					red += e->red;
+				}
+			}
+			if (closed && red <= p)
+				optimum = max(optimum, weight);
+		}
 
-		err = get_p_maxcut_lin(test, p, cut, s, t, LPvalue);
+		vector<int> cut, s, t;
+		double res;
+		int err = get_p_maxcut_heuristic(test, p, cut, s, t, res);
 		if (err)
-			++failures;
+		{
+			if (err != 2 || optimum >= 0)
+			{
+				cout << i << " Error : " << err << endl;
+				++failures;
+			}
+			continue;
+		}
 
-		err = get_p_maxcut_lin(test, p, cut, s, t, ILPvalue, true);
-		if (err)
+		vector<bool> in_S(n, false);
+		for (int v : s)
+			in_S[v] = true;
+		double weight = 0;
+		int red = 0;
+		bool closed = in_S[test.source_id] && !in_S[test.target_id] && (int)(s.size() + t.size()) == n;
+		for (auto e : test.edges)
+		{
+			closed &= in_S[e->id_from] || !in_S[e->id_to];
+			if (in_S[e->id_from] && !in_S[e->id_to])
+			{
+				weight += e->weight;
+				red += e->red;
+			}
+		}
+		if (!closed || red > p || fabs(weight - res) > 1e-6 || res > optimum + 1e-6)
+		{
+			cout << i << fixed << setprecision(5) << " closed " << closed << " red " << red << " res " << res
+				<< " weight " << weight << " optimum " << optimum << endl;
 			++failures;
-
-		cout << entry.path().string() <<  fixed << setprecision(5) << " " << maxcut << " " << LPvalue << " " << ILPvalue << endl;
-		++c;
+		}
 	}
+	cout << "Heuristic p=" << p << " failures : " << failures << " out of " << N << endl;
+	return failures;
 }
 
-void test_folder_convert(string path, int p)
+/* A file of the test folders, and the results computed on it */
+struct TestFile
 {
-	cout << "Folder " << path << " " << p << " MAXCUT LP ILP" << endl;
+	string path;
+	bool convert;
+	Graph graph;
+	double maxcut;
+	vector<double> LPvalue, ILPvalue; // one per value of p
+
+	// Only recorded with --stats
+	ReadStats read_stats;
+	double maxcut_time = 0;
+	vector<SolverStats> LPstats, ILPstats;
+};
+
+/* Extra columns of the output with --stats, after MAXCUT LP ILP */
+static const char *STATS_HEADER = " read_s convert_s n_raw m_raw n m maxcut_s n_red m_red build_s"
+		" LP_solve_s LP_round_s LP_iter ILP_method ILP_solve_s ILP_round_s ILP_iter ILP_nodes ILP_gap";
+
+static void print_stats(const TestFile &file, size_t k)
+{
+	const SolverStats &lp = file.LPstats[k], &ilp = file.ILPstats[k];
+	cout << setprecision(6)
+		<< " " << file.read_stats.read_time << " " << file.read_stats.convert_time
+		<< " " << file.read_stats.n_raw << " " << file.read_stats.m_raw
+		<< " " << file.graph.n_vertices() << " " << file.graph.n_edges()
+		<< " " << file.maxcut_time
+		<< " " << lp.n_vertices << " " << lp.n_edges << " " << lp.build_time
+		<< " " << lp.solve_time << " " << lp.rounding_time << " " << (long)lp.iterations
+		<< " " << ((*ilp.method) ? ilp.method : "-")
+		<< " " << ilp.solve_time << " " << ilp.rounding_time << " " << (long)ilp.iterations
+		<< " " << (long)ilp.nodes << " " << ilp.mip_gap;
+}
 
-	int failures = 0;
-	int c = 0;
-    for (const auto &entry : fs::directory_iterator(path))
+/* Compares the value of the maxcut, p-maxcut and an approximation of the p-maxcut
+ * for all the files (assumed to be correctly formatted dot files) in the given folders,
+ * for each value of p.
+ * For example files, see the subfolders of the test folder of this project.
+ *
+ * The computations run in parallel, one task per file, the largest graphs first.
+ * The output is printed at the end, in the same order as a sequential run :
+ * for each value of p, for each folder, one line per file.
+ *
+ * @param folders 	Paths of the folders to test, with true iff the graphs must be converted to SDFM
+ * @param p_values 	Values of p for the tests
+ * @param n_threads Number of threads, <= 0 for one per hardware thread
+ * @param stats 	true to print the timings and solver statistics as extra columns
+ * @param results 	if not null, each result is appended to it as soon as it is computed,
+ * 					and the results without error it already contains are not computed again
+ * @param time_limit 	if > 0, time limit of each ILP (s) : the ILP column is then the best cut found
+ * 					(see PMaxcutSession::p_maxcut_anytime), and the gap in the stats is its gap to the bound
+ */
+void test_folders(vector<pair<string, bool>> folders, vector<int> p_values, int n_threads, bool stats,
+		ResultsSink *results, double time_limit)
+{
+	vector<vector<TestFile>> files(folders.size());
+	for (size_t f = 0; f < folders.size(); ++f)
 	{
-		Graph test = read_graph_from_file(entry.path(), "", "size", "");
-		test = convert_to_SimpleDataFlow(test);
+		for (const auto &entry : fs::directory_iterator(folders[f].first))
+		{
+			if (entry.path().string().find(".pmc") != string::npos) continue; // cache entries
+			TestFile file;
+			file.path = entry.path().string();
+			file.convert = folders[f].second;
+			file.LPvalue.assign(p_values.size(), -1);
+			file.ILPvalue.assign(p_values.size(), -1);
+			file.LPstats.resize(p_values.size());
+			file.ILPstats.resize(p_values.size());
+			files[f].push_back(file);
+		}
+	}
 
-		vector<int> cut, s, t;
-		double maxcut, LPvalue, ILPvalue;
+	vector<TestFile*> all_files;
+	for (auto &folder : files)
+		for (auto &file : folder)
+			all_files.push_back(&file);
 
-		int err = get_maxcut_lin(test, cut, s, t, maxcut);
+	// Solvers use one thread each when the runner uses several
+	if (n_threads != 1)
+		set_solver_threads(1);
 
-		err = get_p_maxcut_lin(test, p, cut, s, t, LPvalue);
-		if (err)
-			++failures;
+	// Read the graphs and compute the maxcut
+	vector<function<void()>> tasks;
+	for (TestFile *file : all_files)
+	{
+		tasks.push_back([file, stats, results]()
+		{
+			file->graph = read_graph_cached(file->path, file->convert, (stats) ? &file->read_stats : nullptr);
 
-		err = get_p_maxcut_lin(test, p, cut, s, t, ILPvalue, true);
-		if (err)
-			++failures;
+			ResultRecord record;
+			if (results && results->find(file->path, 0, "maxcut", record))
+			{
+				file->maxcut = record.value;
+				file->maxcut_time = record.stats.solve_time;
+				return;
+			}
+
+			vector<int> cut, s, t;
+			double start = (stats || results) ? wall_time() : 0;
+			record.error = get_maxcut_flow(file->graph, cut, s, t, file->maxcut);
+			if (stats || results)
+				file->maxcut_time = wall_time() - start;
+
+			if (results)
+			{
+				record.file = file->path;
+				record.mode = "maxcut";
+				record.value = file->maxcut;
+				record.stats.method = "flow";
+				record.stats.n_vertices = file->graph.n_vertices();
+				record.stats.n_edges = file->graph.n_edges();
+				record.stats.solve_time = file->maxcut_time;
+				results->write(record);
+			}
+		});
+	}
+	run_tasks(tasks, n_threads);
+
+	// Compute the p-maxcuts, largest graphs first
+	vector<TestFile*> by_size(all_files);
+	stable_sort(by_size.begin(), by_size.end(), [](TestFile *a, TestFile *b)
+	{
+		return a->graph.n_edges() > b->graph.n_edges();
+	});
+
+	tasks.clear();
+	for (TestFile *file : by_size)
+	{
+		tasks.push_back([file, &p_values, stats, results, time_limit]()
+		{
+			// One solver session per graph, for all the values of p, built on the first missing result.
+			// The ILP of each p follows its LP, which it reuses.
+			unique_ptr<PMaxcutSession> session;
+			vector<int> cut, s, t;
+			for (size_t k = 0; k < p_values.size(); ++k)
+			{
+				for (bool integral : {false, true})
+				{
+					double &value = (integral) ? file->ILPvalue[k] : file->LPvalue[k];
+					SolverStats &solver_stats = (integral) ? file->ILPstats[k] : file->LPstats[k];
+					string mode = (integral) ? "ilp" : "lp";
+
+					ResultRecord record;
+					if (results && results->find(file->path, p_values[k], mode, record))
+					{
+						value = record.value;
+						solver_stats = record.stats;
+						continue;
+					}
+
+					if (!session)
+						session.reset(new PMaxcutSession(file->graph));
+					SolverStats *record_stats = (stats || results) ? &solver_stats : nullptr;
+					if (integral && time_limit > 0)
+					{
+						AnytimeOptions options;
+						options.time_limit = time_limit;
+						double bound;
+						record.error = session->p_maxcut_anytime(p_values[k], options, cut, s, t, value, bound, record_stats);
+					}
+					else
+						record.error = session->p_maxcut(p_values[k], cut, s, t, value, integral, record_stats);
+
+					if (results)
+					{
+						record.file = file->path;
+						record.p = p_values[k];
+						record.mode = mode;
+						record.value = value;
+						record.stats = solver_stats;
+						results->write(record);
+					}
+				}
+			}
+		});
+	}
+	run_tasks(tasks, n_threads);
 
-		cout << entry.path().string() <<  fixed << setprecision(5) << " " << maxcut << " " << LPvalue << " " << ILPvalue << endl;
-		++c;
+	for (size_t k = 0; k < p_values.size(); ++k)
+	{
+		for (size_t f = 0; f < folders.size(); ++f)
+		{
+			cout << "Folder " << folders[f].first << " " << p_values[k] << " MAXCUT LP ILP" << ((stats) ? STATS_HEADER : "") << endl;
+			for (auto &file : files[f])
+			{
+				cout << file.path <<  fixed << setprecision(5) << " " << file.maxcut << " " << file.LPvalue[k] << " " << file.ILPvalue[k];
+				if (stats)
+					print_stats(file, k);
+				cout << endl;
+			}
+		}
 	}
 }
 
 /* Test a specific set of folders for the given values of p */
-void test_all_folders(vector<int> p_values)
+void test_all_folders(vector<int> p_values, int n_threads, bool stats, ResultsSink *results, double time_limit)
 {
-	for (int p : p_values)
-	{
+	test_folders({
 		// These dataset are already in SDFM
-		for (string folder : {"./tests/Pegasus/GENOME",
-							  "./tests/Pegasus/LIGO",
-							  "./tests/Pegasus/MONTAGE"
-							  })
-			test_folder_pegasus(folder, p);
+		{"./tests/Pegasus/GENOME", false},
+		{"./tests/Pegasus/LIGO", false},
+		{"./tests/Pegasus/MONTAGE", false},
 		// These dataset need to be converted in SDFM
-		for (string folder : {"./tests/randomsets/completeset", 
-							  "./tests/randomsets/completeset-v2",
-							  "./tests/Pegasus/qr-mumps-trees"
-							  })
-			test_folder_convert(folder, p);
-	}
+		{"./tests/randomsets/completeset", true},
+		{"./tests/randomsets/completeset-v2", true},
+		{"./tests/Pegasus/qr-mumps-trees", true}
+		}, p_values, n_threads, stats, results, time_limit);
 }
 
-int main()
+/* Usage : main [--threads N] [--backend gurobi|flow] [--stats] [--results FILE] [--time-limit SECONDS] [--check-heuristic N]
+ * By default, one thread per hardware thread is used.
+ * --backend chooses the LP solver (see backend.h), the default is gurobi if it was built.
+ * Without ILP solver, the ILP column is the best rounding of the LP (except for forests and series-parallel graphs).
+ * --stats adds the timings of each phase, the sizes of the graphs and the solver statistics as extra columns.
+ * --results appends one CSV record per result to FILE (see results.h). If FILE already contains results,
+ * e.g. of an interrupted run, they are reused instead of being computed again (except those with an error).
+ * --time-limit stops each ILP after SECONDS, with the best cut found (its gap is in the stats).
+ * --check-heuristic only checks get_p_maxcut_heuristic on N random multigraphs for p = 1, 2, 3
+ * (see check_heuristic_random), and fails if a cut is wrong.
+ */
+int main(int argc, char **argv)
 {
+	int n_threads = 0;
+	bool stats = false;
+	string results_file;
+	double time_limit = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc)
+			n_threads = stoi(argv[++i]);
+		else if (arg == "--backend" && i + 1 < argc)
+		{
+			if (set_solver_backend(argv[++i]))
+			{
+				cerr << "Unknown backend " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (arg == "--stats")
+			stats = true;
+		else if (arg == "--results" && i + 1 < argc)
+			results_file = argv[++i];
+		else if (arg == "--time-limit" && i + 1 < argc)
+			time_limit = stod(argv[++i]);
+		else if (arg == "--check-heuristic" && i + 1 < argc)
+		{
+			int N = stoi(argv[++i]);
+			srandom(0);
+			int failures = 0;
+			for (int p : {1, 2, 3})
+				failures += check_heuristic_random(N, p);
+			return (failures > 0) ? 1 : 0;
+		}
+		else
+		{
+			cerr << "Usage : " << argv[0] << " [--threads N] [--backend gurobi|flow] [--stats] [--results FILE] [--time-limit SECONDS] [--check-heuristic N]" << endl;
+			return 1;
+		}
+	}
+
+	unique_ptr<ResultsSink> results;
+	if (!results_file.empty())
+	{
+		results.reset(new ResultsSink(results_file));
+		if (!results->is_open())
+		{
+			cerr << "Cannot open " << results_file << endl;
+			return 1;
+		}
+		if (results->n_loaded() > 0)
+			cerr << "Resuming from " << results->n_loaded() << " results of " << results_file << endl;
+	}
+
 	/*for (int p :{1,3,5,10})
 	{
 		srand(0);
 		test_n_random(1, 10, 0.5, 500, 500, p);
 	}*/
-	test_all_folders({1,3,5,10});
+	test_all_folders({1,3,5,10}, n_threads, stats, results.get(), time_limit);
 }
 
 
-Graph read_graph_from_pegasus(string filename, string time_label, string weight_label)
+/* Read a graph of the test folders through the binary cache.
+ * On a cache hit, the Graph is rebuilt from the mapped CSRGraph (no parsing nor conversion, but
+ * its vertices and edges are allocated again). On a cache miss, the dot file is parsed and a new
+ * cache entry is written.
+ *
+ * @param filename 	Name of the dot file
+ * @param convert 	false for Pegasus workflows (already in SDFM), true for graphs that
+ * 					are converted to SDFM after reading
+ * @param stats 	if not null, filled with the timings and the size before the conversion
+ */
+Graph read_graph_cached(string filename, bool convert, ReadStats *stats)
 {
-	Agraph_t *g;
-	FILE *f = fopen(filename.c_str(), "r");
-	g = agread(f, 0);
+	string kind = (convert) ? "sdf" : "pegasus";
+	string cache_file = graph_cache_path(filename, graph_cache_dir, kind);
+	double start = (stats) ? wall_time() : 0;
 
-	int a, b;
-	double w = 0, t = 0;
-	bool r = false;
-	char *tmp;
-	map<int, int> file_to_graph_id;
+	CSRGraph cached;
+	if (load_graph_cache(cache_file, filename, kind, cached))
+	{
+		Graph res = cached.to_graph();
+		if (stats)
+			stats->read_time = wall_time() - start;
+		return res;
+	}
 
 	Graph res;
-	// Parse nodes : these graphs are already in SDFM, don't care about their weight
-	for (auto n = agfstnode(g); n; n = agnxtnode(g,n))
+	if (convert)
 	{
-		a = stoi(agnameof(n));
-		file_to_graph_id[a] = res.add_vertex(0, 0);
+		Graph raw = read_graph_from_file(filename, "", "size", "");
+		double read = (stats) ? wall_time() : 0;
+		res = convert_to_SimpleDataFlow(raw);
+		if (stats)
+		{
+			stats->read_time = read - start;
+			stats->convert_time = wall_time() - read;
+			stats->n_raw = raw.n_vertices();
+			stats->m_raw = raw.n_edges();
+		}
 	}
-	
-	for (auto n = agfstnode(g); n; n = agnxtnode(g,n)) 
+	else
 	{
-		a = stoi(agnameof(n));
-		for (auto e = agfstout(g,n); e; e = agnxtout(g,e)) 
-		{
-			w = 0;
-			t = 1;
-			r = false;
-			b = stoi(agnameof(aghead(e)));
-
-			// Get weight info
-			tmp = agget(e, weight_label.data());
-			if (tmp != NULL)
-				w = stod(tmp);
-
-			tmp = agget(aghead(e), time_label.data());
-			if (tmp != NULL)
-				t = stod(tmp);
-
-			r = (abs(t) < 1e-6) && (b%2 == 0);
-			
-			res.add_edge(file_to_graph_id[a], file_to_graph_id[b], w, r);
+		res = read_graph_from_pegasus(filename);
+		if (stats)
+		{
+			stats->read_time = wall_time() - start;
+			stats->n_raw = res.n_vertices();
+			stats->m_raw = res.n_edges();
 		}
 	}
 
-	res.find_source();
-	res.find_target();
-
-	agclose(g);
-	fclose(f);
+	if (!graph_cache_dir.empty())
+		fs::create_directories(graph_cache_dir);
+	write_graph_cache(CSRGraph(res), cache_file, filename, kind);
 	return res;
-}  
+}
+
@@ -0,0 +1,187 @@
+#include "maxflow.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+/* This file contains a Dinic max-flow solver, used by the combinatorial cut algorithms
+ */
+MaxFlow::MaxFlow(int n /*= 0*/)
+{
+	first_arc.assign(n + 1, 0);
+	adjacency_valid = false;
+	tolerance = 1e-9;
+}
+
+int MaxFlow::add_node()
+{
+	first_arc.push_back(0);
+	adjacency_valid = false;
+	return n_nodes() - 1;
+}
+
+/* Adds an arc and its reverse residual arc to the network
+ *
+ * @return the id of the new arc, the residual arc has id (return value)^1
+ */
+int MaxFlow::add_arc(int from, int to, double capacity)
+{
+	int new_id = arc_head.size();
+	arc_head.push_back(to);
+	arc_residual.push_back(capacity);
+	arc_head.push_back(from);
+	arc_residual.push_back(0);
+	adjacency_valid = false;
+	return new_id;
+}
+
+void MaxFlow::build_adjacency()
+{
+	int n = n_nodes();
+	fill(first_arc.begin(), first_arc.end(), 0);
+	for (int a = 0; a < n_arcs(); ++a)
+		++first_arc[arc_head[a^1] + 1];
+	for (int u = 0; u < n; ++u)
+		first_arc[u + 1] += first_arc[u];
+
+	adjacency.resize(n_arcs());
+	vector<int> pos(first_arc.begin(), first_arc.end() - 1);
+	for (int a = 0; a < n_arcs(); ++a)
+		adjacency[pos[arc_head[a^1]]++] = a;
+
+	adjacency_valid = true;
+}
+
+// BFS from the source in the residual network, return true iff the sink is reached
+bool MaxFlow::compute_levels(int source, int sink)
+{
+	level.assign(n_nodes(), -1);
+	vector<int> queue;
+	queue.reserve(n_nodes());
+
+	queue.push_back(source);
+	level[source] = 0;
+	for (size_t i = 0; i < queue.size(); ++i)
+	{
+		int u = queue[i];
+		for (int k = first_arc[u]; k < first_arc[u + 1]; ++k)
+		{
+			int a = adjacency[k];
+			int v = arc_head[a];
+			if (level[v] == -1 && arc_residual[a] > tolerance)
+			{
+				level[v] = level[u] + 1;
+				queue.push_back(v);
+			}
+		}
+	}
+	return level[sink] != -1;
+}
+
+/* Saturates all shortest augmenting paths of the level graph.
+ * The DFS is iterative : long chains of the big trees would overflow the call stack.
+ */
+double MaxFlow::blocking_flow(int source, int sink)
+{
+	double total = 0;
+	current.assign(first_arc.begin(), first_arc.end() - 1);
+	vector<int> path;
+
+	int u = source;
+	while (true)
+	{
+		if (u == sink)
+		{
+			double delta = numeric_limits<double>::infinity();
+			for (int a : path)
+				delta = min(delta, arc_residual[a]);
+
+			// Augment, and restart from the tail of the first saturated arc
+			size_t cut_at = path.size();
+			for (size_t i = 0; i < path.size(); ++i)
+			{
+				int a = path[i];
+				arc_residual[a]   -= delta;
+				arc_residual[a^1] += delta;
+				if (cut_at == path.size() && arc_residual[a] <= tolerance)
+					cut_at = i;
+			}
+			total += delta;
+			path.resize(cut_at);
+			u = (path.empty()) ? source : arc_head[path.back()];
+			continue;
+		}
+
+		bool advanced = false;
+		for (int &k = current[u]; k < first_arc[u + 1]; ++k)
+		{
+			int a = adjacency[k];
+			int v = arc_head[a];
+			if (level[v] == level[u] + 1 && arc_residual[a] > tolerance)
+			{
+				path.push_back(a);
+				u = v;
+				advanced = true;
+				break;
+			}
+		}
+
+		if (!advanced)
+		{
+			// Dead end : u cannot reach the sink anymore in this phase
+			level[u] = -1;
+			if (u == source) break;
+			int a = path.back();
+			path.pop_back();
+			u = arc_head[a^1];
+			++current[u];
+		}
+	}
+	return total;
+}
+
+/* Pushes as much flow as possible from source to sink.
+ * The current flow is kept, so arcs can be added between two calls.
+ *
+ * @return the amount of flow that was added by this call
+ */
+double MaxFlow::run(int source, int sink)
+{
+	if (!adjacency_valid)
+		build_adjacency();
+
+	double total = 0;
+	while (compute_levels(source, sink))
+		total += blocking_flow(source, sink);
+
+	return total;
+}
+
+/* Computes the set of nodes reachable from the source in the residual network.
+ * After run(), this is the source side of a minimum cut.
+ */
+void MaxFlow::source_side(int source, vector<bool> &side)
+{
+	if (!adjacency_valid)
+		build_adjacency();
+
+	side.assign(n_nodes(), false);
+	vector<int> stack;
+	stack.push_back(source);
+	side[source] = true;
+	while (!stack.empty())
+	{
+		int u = stack.back();
+		stack.pop_back();
+		for (int k = first_arc[u]; k < first_arc[u + 1]; ++k)
+		{
+			int a = adjacency[k];
+			int v = arc_head[a];
+			if (!side[v] && arc_residual[a] > tolerance)
+			{
+				side[v] = true;
+				stack.push_back(v);
+			}
+		}
+	}
+}
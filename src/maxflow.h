@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+/* Maximum flow on a directed network with real capacities (Dinic's algorithm)
+ *
+ * Arcs are stored by pairs : arc 2k is the arc that was added, arc 2k+1 its residual
+ * reverse arc, so the reverse of any arc a is a^1.
+ * A capacity can be infinite (std::numeric_limits<double>::infinity()).
+ */
+class MaxFlow
+{
+private:
+	std::vector<int> arc_head;
+	std::vector<double> arc_residual;
+
+	// Adjacency in CSR form, rebuilt lazily when arcs are added
+	bool adjacency_valid;
+	std::vector<int> first_arc;
+	std::vector<int> adjacency;
+
+	std::vector<int> level;
+	std::vector<int> current;
+
+	void build_adjacency();
+	bool compute_levels(int source, int sink);
+	double blocking_flow(int source, int sink);
+
+public:
+	double tolerance; // residual capacities below this value are considered as 0
+
+	MaxFlow(int n = 0);
+
+	int add_node();
+	int add_arc(int from, int to, double capacity);
+	double run(int source, int sink);
+	void source_side(int source, std::vector<bool> &side);
+
+	inline int n_nodes() const
+	{
+		return first_arc.size() - 1;
+	}
+
+	inline int n_arcs() const
+	{
+		return arc_head.size();
+	}
+
+	inline double residual(int arc) const
+	{
+		return arc_residual[arc];
+	}
+};
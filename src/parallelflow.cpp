@@ -0,0 +1,528 @@
+#include "pmaxcut.h"
+#include "csr.h"
+#include "runner.h"
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/* This file contains the parallel push-relabel max-flow kernel of the maxcut, for the largest graphs
+ */
+
+// Consecutive items (vertices, arcs, nodes) taken by a thread in the parallel loops
+static const size_t CHUNK = 256;
+// A global relabel is done when the arcs scanned since the last one exceed this many times the arcs of the network
+static const double GLOBAL_RELABEL_WORK = 0.5;
+// Below this many active vertices, the rounds run on one thread (see sequential_rounds)
+static const size_t SEQUENTIAL_ACTIVE = 4 * CHUNK;
+
+static void atomic_add(atomic<double> &x, double delta)
+{
+	double old = x.load(memory_order_relaxed);
+	while (!x.compare_exchange_weak(old, old + delta, memory_order_relaxed));
+}
+
+/* Synchronous parallel push-relabel (as Baumstark, Blelloch and Shun) on the network of max_closure
+ * (see flowcut.cpp), built in parallel from the CSR arrays. The infinite arcs s -> source and
+ * target -> t have a capacity larger than the cut {s} instead, so that s can saturate its arcs.
+ *
+ * Each round is made of phases separated by barriers, in which no two threads write the same value :
+ *  - push : each active vertex pushes its excess along its admissible arcs (the head has a label one
+ *    less), with the labels of the start of the round. A thread only writes the residuals of the
+ *    arcs leaving its vertices, the excess pushed to the heads is added atomically to received.
+ *  - the residuals of the reverse arcs of the pushes are increased.
+ *  - the vertices that kept some excess are relabeled, from the residuals after the pushes and the
+ *    labels of the start of the round : the labels stay valid.
+ *  - the vertices with new excess, or relabeled below the number of nodes, are the next active set.
+ * A global relabel (parallel breadth-first search from t in the residual network) sets the exact
+ * labels at the start, after a fixed amount of work, and when no vertex is active : if no vertex
+ * is active after it either, the preflow is maximum, and the vertices that cannot reach t are the
+ * source side of a minimum cut. The work is split by chunks of vertices between the threads of a
+ * team, which lives for the whole run (see run_team), except for the rounds with few active vertices.
+ */
+class ParallelPushRelabel
+{
+private:
+	const CSRGraph &graph;
+	int n_threads;
+	Barrier barrier;
+
+	uint32_t n, m;			// vertices and edges of the graph
+	uint32_t n_nodes;		// the vertices, then s = n and t = n + 1
+	uint32_t s, t;
+	double big;				// capacity of s -> source and target -> t
+	double tol;				// residuals and excesses below this value are considered as 0
+
+	vector<double> c;		// weight out of v minus weight into v
+	vector<double> partial_sum;	// per thread
+	vector<uint32_t> first_arc;		// arcs leaving each node in adjacency, the reverse of arc a is a^1
+	unique_ptr<uint32_t[]> adjacency;
+	unique_ptr<uint32_t[]> arc_head;
+	unique_ptr<double[]> residual;
+
+	vector<double> excess;
+	unique_ptr<atomic<double>[]> received;	// excess pushed to each node since it was last active
+	unique_ptr<atomic<uint32_t>[]> label;
+	vector<uint32_t> new_label;
+	unique_ptr<atomic<bool>[]> queued;		// in the next active set
+
+	vector<uint32_t> active, frontier;
+	vector<vector<uint32_t>> next;		// next active set or level of the search, one part per thread
+	vector<vector<pair<uint32_t,double>>> pushes;	// arcs pushed and amounts, per thread
+	vector<vector<uint32_t>> relabels;	// vertices to relabel, per thread
+	vector<size_t> offsets;
+	atomic<long> work;		// arcs scanned since the last global relabel
+	bool exact;				// no round since the last global relabel
+
+	template<typename F>
+	void for_chunks(size_t size, int id, F f)
+	{
+		for (size_t begin = id * CHUNK; begin < size; begin += n_threads * CHUNK)
+		{
+			size_t end = min(size, begin + CHUNK);
+			for (size_t i = begin; i < end; ++i)
+				f(i);
+		}
+	}
+
+	void build(int id);
+	void gather(int id, vector<uint32_t> &list);
+	void absorb(int id);
+	void global_relabel(int id);
+	long push(uint32_t v, int id);
+	void reverse_pushes(int id);
+	long relabel(uint32_t v);
+	void apply_relabels(int id);
+	void round(int id);
+	void sequential_rounds(double limit);
+	void run_thread(int id);
+
+public:
+	ParallelPushRelabel(const CSRGraph &graph, int n_threads);
+
+	void run();
+
+	inline bool source_side(uint32_t v) const
+	{
+		return label[v] >= n_nodes;
+	}
+};
+
+ParallelPushRelabel::ParallelPushRelabel(const CSRGraph &graph, int n_threads)
+	: graph(graph), n_threads((n_threads > 0) ? n_threads : default_thread_count()), barrier(this->n_threads)
+{
+	n = graph.n_vertices();
+	m = graph.n_edges();
+	n_nodes = n + 2;
+	s = n;
+	t = n + 1;
+}
+
+/* Builds the network and saturates the arcs leaving s.
+ * Pair of arcs e (arcs 2e and 2e+1) is the arc edge_to[e] -> edge_from[e] of edge e, pair m + v the
+ * arc s -> v, pair m + n + v the arc v -> t, then s -> source and target -> t.
+ */
+void ParallelPushRelabel::build(int id)
+{
+	int source = graph.source_id, target = graph.target_id;
+	const double inf = numeric_limits<double>::infinity();
+	if (id == 0)
+	{
+		c.resize(n);
+		partial_sum.assign(n_threads, 0);
+		next.resize(n_threads);
+		pushes.resize(n_threads);
+		relabels.resize(n_threads);
+		excess.resize(n_nodes);
+		new_label.resize(n_nodes);
+		received.reset(new atomic<double>[n_nodes]);
+		label.reset(new atomic<uint32_t>[n_nodes]);
+		queued.reset(new atomic<bool>[n_nodes]);
+	}
+	barrier.wait();
+
+	for_chunks(n, id, [&](size_t v)
+	{
+		double sum = 0;
+		for (uint32_t k = graph.out_offsets[v]; k < graph.out_offsets[v + 1]; ++k)
+			sum += graph.weight[graph.out_edges[k]];
+		for (uint32_t k = graph.in_offsets[v]; k < graph.in_offsets[v + 1]; ++k)
+			sum -= graph.weight[graph.in_edges[k]];
+		c[v] = sum;
+		partial_sum[id] += max(sum, 0.0);
+	});
+	barrier.wait();
+
+	if (id == 0)
+	{
+		double positive = 0;
+		for (int i = 0; i < n_threads; ++i)
+			positive += partial_sum[i];
+		big = 2 * positive + 1;
+		tol = 1e-12 * big;	// relative to the largest capacity, as in max_closure
+
+		first_arc.resize(n_nodes + 1);
+		first_arc[0] = 0;
+		for (uint32_t u = 0; u < n; ++u)
+		{
+			uint32_t degree = graph.in_degree(u) + graph.out_degree(u) + 2 + (u == (uint32_t)source) + (u == (uint32_t)target);
+			first_arc[u + 1] = first_arc[u] + degree;
+		}
+		first_arc[s + 1] = first_arc[s] + n + 1;
+		first_arc[t + 1] = first_arc[t] + n + 1;
+
+		size_t n_arcs = 2 * ((size_t)m + 2 * n + 2);
+		adjacency.reset(new uint32_t[n_arcs]);
+		arc_head.reset(new uint32_t[n_arcs]);
+		residual.reset(new double[n_arcs]);
+	}
+	barrier.wait();
+
+	for_chunks(m, id, [&](size_t e)
+	{
+		arc_head[2 * e] = graph.edge_from[e];
+		residual[2 * e] = inf;
+		arc_head[2 * e + 1] = graph.edge_to[e];
+		residual[2 * e + 1] = 0;
+	});
+
+	for_chunks(n, id, [&](size_t v)
+	{
+		size_t from_s = m + v, to_t = m + n + v;
+		double capacity = max(c[v], 0.0);
+		arc_head[2 * from_s] = v;
+		residual[2 * from_s] = 0;	// saturated
+		arc_head[2 * from_s + 1] = s;
+		residual[2 * from_s + 1] = capacity;
+		arc_head[2 * to_t] = t;
+		residual[2 * to_t] = max(-c[v], 0.0);
+		arc_head[2 * to_t + 1] = v;
+		residual[2 * to_t + 1] = 0;
+		excess[v] = capacity + ((v == (size_t)source) ? big : 0);
+
+		uint32_t pos = first_arc[v];
+		for (uint32_t k = graph.in_offsets[v]; k < graph.in_offsets[v + 1]; ++k)
+			adjacency[pos++] = 2 * graph.in_edges[k];
+		for (uint32_t k = graph.out_offsets[v]; k < graph.out_offsets[v + 1]; ++k)
+			adjacency[pos++] = 2 * graph.out_edges[k] + 1;
+		adjacency[pos++] = 2 * from_s + 1;
+		adjacency[pos++] = 2 * to_t;
+		if (v == (size_t)source)
+			adjacency[pos++] = 2 * ((size_t)m + 2 * n) + 1;
+		if (v == (size_t)target)
+			adjacency[pos++] = 2 * ((size_t)m + 2 * n + 1);
+
+		adjacency[first_arc[s] + v] = 2 * from_s;
+		adjacency[first_arc[t] + v] = 2 * to_t + 1;
+	});
+
+	for_chunks(n_nodes, id, [&](size_t u)
+	{
+		received[u].store(0, memory_order_relaxed);
+		queued[u].store(false, memory_order_relaxed);
+	});
+
+	if (id == 0)
+	{
+		size_t to_source = m + 2 * n, from_target = m + 2 * n + 1;
+		arc_head[2 * to_source] = source;
+		residual[2 * to_source] = 0;	// saturated
+		arc_head[2 * to_source + 1] = s;
+		residual[2 * to_source + 1] = big;
+		arc_head[2 * from_target] = t;
+		residual[2 * from_target] = big;
+		arc_head[2 * from_target + 1] = target;
+		residual[2 * from_target + 1] = 0;
+		adjacency[first_arc[s] + n] = 2 * to_source;
+		adjacency[first_arc[t] + n] = 2 * from_target + 1;
+		excess[s] = 0;
+		excess[t] = 0;
+		work = 0;
+	}
+	barrier.wait();
+}
+
+// Concatenates the parts of next into list, in the order of the threads
+void ParallelPushRelabel::gather(int id, vector<uint32_t> &list)
+{
+	barrier.wait();
+	if (id == 0)
+	{
+		offsets.assign(n_threads + 1, 0);
+		for (int i = 0; i < n_threads; ++i)
+			offsets[i + 1] = offsets[i] + next[i].size();
+		list.resize(offsets[n_threads]);
+	}
+	barrier.wait();
+	copy(next[id].begin(), next[id].end(), list.begin() + offsets[id]);
+	next[id].clear();
+	barrier.wait();
+}
+
+// Adds the excess received by the active vertices, which leave the next active set
+void ParallelPushRelabel::absorb(int id)
+{
+	for_chunks(active.size(), id, [&](size_t i)
+	{
+		uint32_t v = active[i];
+		queued[v].store(false, memory_order_relaxed);
+		excess[v] += received[v].exchange(0, memory_order_relaxed);
+	});
+	barrier.wait();
+}
+
+/* Sets the labels to the distances to t in the residual network (n_nodes if t cannot be reached),
+ * and the active set to the vertices with excess that can reach t.
+ */
+void ParallelPushRelabel::global_relabel(int id)
+{
+	absorb(id);
+	for_chunks(n_nodes, id, [&](size_t u)
+	{
+		label[u].store(n_nodes, memory_order_relaxed);
+	});
+	barrier.wait();
+	if (id == 0)
+	{
+		label[t].store(0, memory_order_relaxed);
+		frontier.assign(1, t);
+	}
+	barrier.wait();
+
+	uint32_t level = 0;
+	while (!frontier.empty())
+	{
+		++level;
+		for_chunks(frontier.size(), id, [&](size_t i)
+		{
+			uint32_t x = frontier[i];
+			for (uint32_t k = first_arc[x]; k < first_arc[x + 1]; ++k)
+			{
+				uint32_t a = adjacency[k];
+				uint32_t u = arc_head[a];
+				if (u == s || residual[a^1] <= tol) continue; // u -> x is not residual
+				uint32_t unreached = n_nodes;
+				if (label[u].load(memory_order_relaxed) == n_nodes
+					&& label[u].compare_exchange_strong(unreached, level, memory_order_relaxed))
+					next[id].push_back(u);
+			}
+		});
+		gather(id, frontier);
+	}
+
+	for_chunks(n, id, [&](size_t v)
+	{
+		if (excess[v] > tol && label[v].load(memory_order_relaxed) < n_nodes)
+			next[id].push_back(v);
+	});
+	if (id == 0)
+	{
+		work = 0;
+		exact = true;
+	}
+	gather(id, active);
+}
+
+// Pushes the excess of an active vertex along its admissible arcs, @return the arcs scanned
+long ParallelPushRelabel::push(uint32_t v, int id)
+{
+	uint32_t d = label[v].load(memory_order_relaxed);
+	double e = excess[v];
+	if (d >= n_nodes || e <= tol) return 0;
+
+	long scanned = 0;
+	for (uint32_t k = first_arc[v]; k < first_arc[v + 1] && e > tol; ++k)
+	{
+		++scanned;
+		uint32_t a = adjacency[k];
+		if (residual[a] <= tol) continue;
+		uint32_t w = arc_head[a];
+		if (label[w].load(memory_order_relaxed) + 1 != d) continue;
+
+		double delta = min(e, residual[a]);
+		residual[a] -= delta;
+		e -= delta;
+		pushes[id].push_back(make_pair(a, delta));
+		atomic_add(received[w], delta);
+		if (w != s && w != t && !queued[w].exchange(true, memory_order_relaxed))
+			next[id].push_back(w);
+	}
+	excess[v] = e;
+	if (e > tol)
+		relabels[id].push_back(v);
+	return scanned;
+}
+
+// Increases the residuals of the reverse arcs of the pushes of a thread
+void ParallelPushRelabel::reverse_pushes(int id)
+{
+	for (auto &push : pushes[id])
+		residual[push.first^1] += push.second;
+	pushes[id].clear();
+}
+
+// Computes the new label of a vertex that kept some excess, @return the arcs scanned
+long ParallelPushRelabel::relabel(uint32_t v)
+{
+	uint32_t d = n_nodes;
+	for (uint32_t k = first_arc[v]; k < first_arc[v + 1]; ++k)
+	{
+		uint32_t a = adjacency[k];
+		if (residual[a] > tol)
+			d = min(d, label[arc_head[a]].load(memory_order_relaxed) + 1);
+	}
+	new_label[v] = d;
+	return first_arc[v + 1] - first_arc[v];
+}
+
+// Sets the labels computed by the relabels of a thread
+void ParallelPushRelabel::apply_relabels(int id)
+{
+	for (uint32_t v : relabels[id])
+	{
+		label[v].store(new_label[v], memory_order_relaxed);
+		if (new_label[v] < n_nodes && !queued[v].exchange(true, memory_order_relaxed))
+			next[id].push_back(v);
+	}
+	relabels[id].clear();
+}
+
+void ParallelPushRelabel::round(int id)
+{
+	absorb(id);
+	if (id == 0)
+		exact = false;
+
+	// Push, with the labels of the start of the round
+	long scanned = 0;
+	for_chunks(active.size(), id, [&](size_t i)
+	{
+		scanned += push(active[i], id);
+	});
+	barrier.wait();
+	reverse_pushes(id);
+	barrier.wait();
+
+	// Relabel, with the residuals after the pushes
+	for (uint32_t v : relabels[id])
+		scanned += relabel(v);
+	barrier.wait();
+	apply_relabels(id);
+	work += scanned;
+	gather(id, active);
+}
+
+/* Runs the same rounds on thread 0 alone while the active set is small (the other threads
+ * wait at the next barrier) : the barriers would cost more than the rounds.
+ */
+void ParallelPushRelabel::sequential_rounds(double limit)
+{
+	while (!active.empty() && active.size() < SEQUENTIAL_ACTIVE && work <= limit)
+	{
+		exact = false;
+		long scanned = 0;
+		for (uint32_t v : active)
+		{
+			queued[v].store(false, memory_order_relaxed);
+			excess[v] += received[v].exchange(0, memory_order_relaxed);
+		}
+		for (uint32_t v : active)
+			scanned += push(v, 0);
+		reverse_pushes(0);
+		for (uint32_t v : relabels[0])
+			scanned += relabel(v);
+		apply_relabels(0);
+		work += scanned;
+		active.swap(next[0]);
+		next[0].clear();
+	}
+}
+
+/* All the threads take the same decisions : the values they read at the start of each
+ * iteration are only written once every thread has passed a barrier of that iteration.
+ */
+void ParallelPushRelabel::run_thread(int id)
+{
+	build(id);
+	global_relabel(id);
+	double limit = GLOBAL_RELABEL_WORK * first_arc[n_nodes];
+	while (true)
+	{
+		if (active.empty())
+		{
+			if (exact) break;
+			global_relabel(id);
+		}
+		else if (work > limit)
+			global_relabel(id);
+		else if (active.size() < SEQUENTIAL_ACTIVE && n_threads > 1)
+		{
+			barrier.wait();	// the other threads have read active.size()
+			if (id == 0)
+				sequential_rounds(limit);
+			barrier.wait();
+		}
+		else
+			round(id);
+	}
+}
+
+void ParallelPushRelabel::run()
+{
+	run_team(n_threads, [this](int id) { run_thread(id); });
+}
+
+/**
+ * @private
+ *  Compute the maximum topological cut of a DAG in CSR format with a parallel max-flow algorithm
+ *  (see ParallelPushRelabel), for the largest graphs. Same outputs as get_maxcut_flow_csr, with the
+ *  same value. If several cuts are maximum, the S set returned is the largest one (get_maxcut_flow_csr
+ *  returns the smallest one).
+ *
+ * @param graph	the DAG in CSR format
+ * @param cut 	vector that will contain the edges of the cut
+ * @param S 	vector that will contain the S set after the cut
+ * @param T		vector that will contain the T set after the cut
+ * @param res 	double where the max cut value will be stored
+ * @param n_threads Number of threads, <= 0 for one per hardware thread
+ *
+ *
+ * @return 0 if everything went well, 3 if the source or the target are not set.
+ */
+int get_maxcut_parallel(const CSRGraph &graph,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res, int n_threads)
+{
+	int source = graph.source_id, target = graph.target_id;
+	if (source == -1 || target == -1) return 3;
+
+	cut.clear();
+	S.clear();
+	T.clear();
+
+	ParallelPushRelabel flow(graph, n_threads);
+	flow.run();
+
+	int n = graph.n_vertices();
+	int m = graph.n_edges();
+	res = 0;
+	for (int e = 0; e < m; ++e)
+	{
+		if (flow.source_side(graph.edge_from[e]) && !flow.source_side(graph.edge_to[e]))
+		{
+			res += graph.weight[e];
+			cut.push_back(e);
+		}
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		if (flow.source_side(i))
+			S.push_back(i);
+		else
+			T.push_back(i);
+	}
+	return 0;
+}
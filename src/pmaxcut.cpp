@@ -1,262 +1,468 @@
-#include "gurobi_c++.h"
 #include "pmaxcut.h"
+#include "backend.h"
 #include <vector>
 #include <iostream>
 #include <cstdio>
+#include <cstring>
 #include <algorithm>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <limits>
 
 using namespace std;
 
-/**
- * @private
- *  Compute the maximum topological cut of a DAG stored as a Graph, as described in IPDPS'18
- * 
- * @param graph	the DAG in Graph format
- * @param cut 	vector that will contain the edges of the cut
- * @param S 	vector that will contain the S set after the cut
- * @param T		vector that will contain the T set after the cut
- * @param res 	double where the max cut value will be stored
+// Relative gap under which the best rounding of the LP is considered optimal for the ILP
+static const double OPTIMALITY_TOLERANCE = 1e-6;
+
+// Time in seconds, for the statistics
+static double wall_time()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Number of threads of each solver call, 0 for the solver default
+static int solver_threads = 0;
+
+#ifdef WITH_GUROBI
+static const char *solver_backend = "gurobi";
+#else
+static const char *solver_backend = "flow";
+#endif
+
+/* Sets the number of threads used by each call to the LP/ILP solver.
+ * Should be 1 when several solver calls run in parallel.
  *
+ * @param n_threads number of threads, 0 for the solver default (all cores)
+ */
+void set_solver_threads(int n_threads)
+{
+	solver_threads = n_threads;
+}
+
+/* Sets the backend of the sessions created afterwards (see backend.h) :
+ * "gurobi" (the default, if built with WITH_GUROBI) or "flow" (without LP solver, LP only).
  *
- * @return 0 if everything went well, then the result is in the last arg. 1 if there was an error in gurobi.
+ * @return 0 if everything went well, 1 if the backend is unknown or was not built
  */
-int get_maxcut_lin(const Graph &graph,
-		vector<int> &cut, vector<int> &S, vector<int> &T, double & res)
+int set_solver_backend(const char *name)
 {
-	int source = graph.source_id, target = graph.target_id;
-	if (source == -1 || target == -1) return 3;
+	if (strcmp(name, "flow") == 0)
+	{
+		solver_backend = "flow";
+		return 0;
+	}
+#ifdef WITH_GUROBI
+	if (strcmp(name, "gurobi") == 0)
+	{
+		solver_backend = "gurobi";
+		return 0;
+	}
+#endif
+	return 1;
+}
+
+/* Builds the backend of the p-maxcut LP of a graph.
+ * The graph must outlive the session.
+ */
+PMaxcutSession::PMaxcutSession(const Graph &graph) : build_time(wall_time()), reduction(graph)
+{
+	error = 0;
+	lp_p_max = -1;
+	const Graph &reduced = reduction.reduced;
+	if (reduced.source_id == -1 || reduced.target_id == -1)
+	{
+		error = 3;
+		build_time = 0;
+		return;
+	}
+
+#ifdef WITH_GUROBI
+	if (strcmp(solver_backend, "gurobi") == 0)
+		backend = make_gurobi_backend(reduced, solver_threads);
+	else
+#endif
+		backend.reset(new FlowBackend(reduced));
+
+	if (!backend)
+		error = 1;
+	build_time = wall_time() - build_time;
+}
+
+PMaxcutSession::~PMaxcutSession()
+{
+}
+
+// Statistics common to all the solves of the session
+void PMaxcutSession::record_stats(SolverStats *stats, const char *method)
+{
+	*stats = SolverStats();
+	stats->method = method;
+	stats->n_vertices = reduction.reduced.n_vertices();
+	stats->n_edges = reduction.reduced.n_edges();
+	stats->build_time = build_time;
+}
+
+/* Computes the maximum topological cut, as get_maxcut_lin
+ * (the p_max constraint is relaxed)
+ *
+ * @return 0 if everything went well, 1 if there was an error in gurobi, 3 if the source or the target are not set.
+ */
+int PMaxcutSession::maxcut(vector<int> &cut, vector<int> &S, vector<int> &T, double &res, SolverStats *stats)
+{
+	if (error) return error;
 
 	cut.clear();
 	S.clear();
 	T.clear();
 
-	int n = graph.n_vertices();
+	const Graph &reduced = reduction.reduced;
+	int n = reduced.n_vertices();
+	int n_red = 0;
+	for (auto e : reduced.edges)
+		n_red += e->red;
+
+	if (stats)
+		record_stats(stats, "lp");
+	vector<double> pi_values;
+	double bound;
+	double start = wall_time();
+	int err = backend->solve(n_red, false, pi_values, bound, stats);
+	if (err) return err;
+	double solved = wall_time();
 
-	try
+	// any rounding in ]0,1[ is OK
+	// See paper by Marchal &al
+	double w = 0.5; 
+	vector<int> reduced_S;
+	for (int i = 0; i < n; ++i)
 	{
-		GRBEnv env = GRBEnv(true);
-		env.set("LogFile", "gurobi.log");
-		env.set(GRB_IntParam_OutputFlag, 0);
-		env.start();
-		GRBModel model = GRBModel(env);
-		vector<GRBVar> p;
-		for (int i = 0; i < n; ++i)
-		{
-			p.push_back(model.addVar(0.0, 1.0, 0.0, GRB_CONTINUOUS, "p_" + to_string(i)));
-		}
+		if (pi_values[i] > w)
+			reduced_S.push_back(i);
+	}
+	reduction.expand(reduced_S, cut, S, T, res);
 
-		GRBLinExpr obj(0);
-		for (auto e : graph.edges)
-		{
-			int a = e->id_from;
-			int b = e->id_to;
-			auto tmp = p[a] - p[b];
-			obj += tmp * e->weight;
-			model.addConstr(tmp >= 0);
-		}
-		model.setObjective(obj, GRB_MAXIMIZE);
+	if (stats)
+	{
+		stats->solve_time = solved - start;
+		stats->rounding_time = wall_time() - solved;
+	}
+	return 0;
+}
 
-		model.addConstr(p[source] == 1);
-		model.addConstr(p[target] == 0);
+/* Solves the LP for p_max and keeps its best rounding, unless it was the last LP solved.
+ * The times of the solve and of the rounding are added to the stats.
+ */
+int PMaxcutSession::relaxation(int p_max, SolverStats *stats)
+{
+	if (lp_p_max == p_max) return 0;
 
-		model.optimize();
+	const Graph &reduced = reduction.reduced;
+	vector<double> pi_values;
+	double start = wall_time();
+	int err = backend->solve(p_max, false, pi_values, lp_bound, stats);
+	if (err)
+	{
+		lp_p_max = -1;
+		return err;
+	}
+	double solved = wall_time();
 
-		vector<double> pi_values(n,0);
-		for (int i = 0; i < n; ++i)
-		{
-			pi_values[i] = p[i].get(GRB_DoubleAttr_X);
-		}
-		
+	// Find the rounding that yields the best cut
+	// Only keeps these with less than $p$ red edges
+	vector<int> reduced_cut, reduced_T;
+	round_p_maxcut(reduced, pi_values, p_max, reduced_cut, lp_S, reduced_T, lp_res);
+	lp_p_max = p_max;
 
-		// any rounding in ]0,1[ is OK
-		// See paper by Marchal &al
-		double w = 0.5; 
-		res = 0;
-		for (auto e : graph.edges)
-		{
-			int a = e->id_from;
-			int b = e->id_to;
-			if (pi_values[a] > w && pi_values[b] <= w)
-			{
-				res += e->weight;
-				cut.push_back(e->id);
-			}
-		}
-		for (int i = 0; i < n; ++i)
-		{
-			if (pi_values[i] > w)
-			{
-				S.push_back(i);
-			}
-			else
-			{
-				T.push_back(i);
-			}
-		}
-	}
-	catch (GRBException e)
+	if (stats)
 	{
-		std::cerr << "GRB Error : " << e.getMessage() << '\n';
-		return 1;
+		stats->solve_time += solved - start;
+		stats->rounding_time += wall_time() - solved;
 	}
-
 	return 0;
 }
 
-/**
- * @private
- *  Compute the p-maximum topological cut of a DAG stored as a Graph, as described in my APCDM
- * 
- * @param graph	the DAG in Graph format
- * @param p_max 	value of p
- * @param cut 	vector that will contain the edges of the cut
- * @param S 	vector that will contain the S set after the cut
- * @param T		vector that will contain the T set after the cut
- * @param res 	double where the max cut value will be stored
- * @param integral 	true iff we want to solve the ILP, otherwise solve fractional relaxation
- *
+/* Computes the p-maximum topological cut, as get_p_maxcut_lin.
+ * The backend is built once for all the calls (for Gurobi, only the right hand side of the
+ * proc_count constraint and the type of the variables change : the solver restarts from
+ * the previous basis).
+ * The ILP is solved by integral_cut, without limits.
  *
- * @return 0 if everything went well, then the result is in the last arg. 1 if there was an error in gurobi.
+ * @return 0 if everything went well, 1 if there was an error in gurobi, 2 if no cut of a forest
+ *  or a series-parallel graph (or no cut at all, with the flow backend) has at most p_max red edges,
+ *  3 if the source or the target are not set.
  */
-int get_p_maxcut_lin(const Graph &graph, int p_max,
-		vector<int> &cut, vector<int> &S, vector<int> &T, double & res, bool integral)
+int PMaxcutSession::p_maxcut(int p_max, vector<int> &cut, vector<int> &S, vector<int> &T, double &res, bool integral,
+		SolverStats *stats)
 {
-	int source = graph.source_id, target = graph.target_id;
-	if (source == -1 || target == -1) return 3;
+	if (error) return error;
+
+	if (integral)
+	{
+		double bound;
+		return integral_cut(p_max, nullptr, cut, S, T, res, bound, stats);
+	}
 
 	cut.clear();
 	S.clear();
 	T.clear();
-
 	res = -1;
-	int n = graph.n_vertices();
 
-	try
+	if (stats)
+		record_stats(stats, "lp");
+	int err = relaxation(p_max, stats);
+	if (err) return err;
+
+	double start = wall_time();
+	if (!lp_S.empty())
+		reduction.expand(lp_S, cut, S, T, res);
+	else
+		res = 0; // no rounding has at most p_max red edges
+	if (stats)
+		stats->rounding_time += wall_time() - start;
+	return 0;
+}
+
+/* Computes the p-maximum topological cut within a budget : when a limit of the options is
+ * reached, the result is the best cut found, with the best proven upper bound of the
+ * p-maxcut and their relative gap in the stats. Same return values as p_maxcut.
+ *
+ * @param options 	limits of the solve, and callback of the improving cuts and bounds
+ * @param bound 	double where the upper bound will be stored (equal to res if the cut is optimal)
+ */
+int PMaxcutSession::p_maxcut_anytime(int p_max, const AnytimeOptions &options,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res, double &bound, SolverStats *stats)
+{
+	if (error) return error;
+	return integral_cut(p_max, &options, cut, S, T, res, bound, stats);
+}
+
+/* Solves the ILP, within the limits of the options if not null.
+ * The ILP of a forest (e.g. an assembly tree) or of a series-parallel graph is solved by
+ * get_p_maxcut_tree or get_p_maxcut_sp instead.
+ *
+ * Otherwise, the ILP starts from the LP (reused if the last call solved it for the same p_max) :
+ * its best rounding is the first cut, and its value the first bound. If the rounding reaches the
+ * value of the LP, it is optimal and no ILP is solved (method "rounded" in the stats). Else the ILP
+ * is solved with the rounding as starting solution and the variables fixed by their reduced costs
+ * (see CutBackend::solve_integral), in the time left after the LP : its cut replaces the rounding
+ * only if it is at least as good. If the backend does not support the ILP (or no time is left, or
+ * it fails), the result is the rounding, with the value of the LP as bound : for the flow backend,
+ * the bound of the Lagrangian relaxation of proc_count.
+ * The LP itself is not interrupted by the time limit.
+ */
+int PMaxcutSession::integral_cut(int p_max, const AnytimeOptions *options,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res, double &bound, SolverStats *stats)
+{
+	const Graph &reduced = reduction.reduced;
+	vector<int> reduced_cut, reduced_S, reduced_T;
+	double begin = wall_time();
+
+	double best_cut = -numeric_limits<double>::infinity();
+	double best_bound = numeric_limits<double>::infinity();
+	auto report = [&](double value, double value_bound)
 	{
-		GRBEnv env = GRBEnv(true);
-		env.set("LogFile", "gurobi.log");
-		env.set(GRB_IntParam_OutputFlag, 0);
-		env.start();
-		GRBModel model = GRBModel(env);
-		vector<GRBVar> p;
-		for (int i = 0; i < n; ++i)
+		if (!options || !options->progress) return;
+		if (value > best_cut || value_bound < best_bound)
 		{
-			p.push_back(model.addVar(0.0, 1.0, 0.0, (integral) ? GRB_BINARY : GRB_CONTINUOUS, "p_" + to_string(i)));
+			best_cut = max(best_cut, value);
+			best_bound = min(best_bound, value_bound);
+			options->progress(best_cut, best_bound, wall_time() - begin);
 		}
+	};
 
-		GRBLinExpr obj(0);
-		GRBLinExpr proc_count(0);
-		vector<GRBLinExpr> tmps;
-		for (auto e : graph.edges)
+	const char *method = "tree";
+	int err = get_p_maxcut_tree(reduced, p_max, reduced_cut, reduced_S, reduced_T, res);
+	if (err == 4) // not a forest
+	{
+		method = "sp";
+		err = get_p_maxcut_sp(reduced, p_max, reduced_cut, reduced_S, reduced_T, res);
+	}
+	double solved = wall_time();
+	if (err == 0)
+	{
+		reduction.expand(reduced_S, cut, S, T, res);
+		bound = res;
+		report(res, bound);
+	}
+	if (err != 4) // 4 : not series-parallel, use the ILP
+	{
+		if (stats)
 		{
-			int a = e->id_from;
-			int b = e->id_to;
-			auto tmp = p[a] - p[b];
-			tmps.push_back(tmp);
-			obj += tmp * (e->weight);
-			if (e->red)
-			{
-				proc_count += tmp;
-			}
-			model.addConstr(tmp >= 0);
+			record_stats(stats, method);
+			stats->solve_time = solved - begin;
+			stats->rounding_time = wall_time() - solved;
 		}
-		model.setObjective(obj, GRB_MAXIMIZE);
+		return err;
+	}
+
+	cut.clear();
+	S.clear();
+	T.clear();
+
+	res = -1;
+	int n = reduced.n_vertices();
+
+	if (stats)
+		record_stats(stats, "lp");
+	err = relaxation(p_max, stats);
+	if (err) return err;
+	reduced_S = lp_S;
+	double start_value = (lp_S.empty()) ? -numeric_limits<double>::infinity() : lp_res;
+	bound = lp_bound;
+	report((lp_S.empty()) ? 0 : lp_res, bound);
 
-		model.addConstr(proc_count <= p_max);
-		model.addConstr(p[source] == 1);
-		model.addConstr(p[target] == 0);
+	double time_left = numeric_limits<double>::infinity();
+	if (options && options->time_limit > 0)
+		time_left = options->time_limit - (wall_time() - begin);
 
-		model.optimize();
+	double tol = OPTIMALITY_TOLERANCE * max(1.0, fabs(lp_bound));
+	if (lp_res >= lp_bound - tol)
+	{
+		if (stats) stats->method = "rounded";
+	}
+	else if (backend->supports_integral() && time_left > 0)
+	{
+		vector<double> start_values(n, 0);
+		for (int v : lp_S)
+			start_values[v] = 1;
 
-		vector<double> pi_values(n,0);
-		for (int i = 0; i < n; ++i)
+		// The limits left to the backend, its progress is reported with the bound of the LP
+		AnytimeOptions backend_options;
+		if (options)
 		{
-			pi_values[i] = p[i].get(GRB_DoubleAttr_X);
+			backend_options.time_limit = (options->time_limit > 0) ? time_left : 0;
+			backend_options.node_limit = options->node_limit;
+			if (options->progress)
+			{
+				backend_options.progress = [&](double value, double value_bound, double)
+				{
+					report(value, min(value_bound, lp_bound));
+				};
+			}
 		}
-		
-		double opt = model.get(GRB_DoubleAttr_ObjVal);
 
-		S.clear();
-		T.clear();
-		res = -1;
-		if (integral)
+		if (stats) stats->method = "ilp";
+		vector<double> pi_values;
+		double ilp_bound;
+		double start = wall_time();
+		err = backend->solve_integral(p_max, start_values, start_value, (options) ? &backend_options : nullptr,
+			pi_values, ilp_bound, stats);
+		if (stats) stats->solve_time += wall_time() - start;
+		if (err == 0)
 		{
+			bound = min(bound, ilp_bound);
+
 			// All values are 0 or 1
 			// Get the values of the cut
-			res = opt;
 			double w = 0.5;
+			vector<int> ilp_S;
+			vector<bool> in_S(n, false);
 			for (int i = 0; i < n; ++i)
 			{
 				if (pi_values[i] > w)
-					S.push_back(i);
-				else
-					T.push_back(i);
-			}
-			for (auto e : graph.edges)
-			{
-				int a = e->id_from;
-				int b = e->id_to;
-				if (pi_values[a] > w && pi_values[b] <= w)
 				{
-					cut.push_back(e->id);
+					ilp_S.push_back(i);
+					in_S[i] = true;
 				}
 			}
-		}
-		else
-		{
-			// Find the rounding that yields the best cut
-			// Only keeps these with less than $p$ red edges
-			double ma = 0; 
-	
-			pi_values.push_back(0 + __DBL_EPSILON__);
-			pi_values.push_back(1 - __DBL_EPSILON__);
-			for	(double w : pi_values)
+			double value = 0;
+			for (auto e : reduced.edges)
 			{
-				w -= 1e-6; // avoid rounding errors.
-				cut.clear();
-				int n_proc = 0;
-				double tmp = 0;
-
-				for (auto e : graph.edges)
-				{
-					int a = e->id_from;
-					int b = e->id_to;
-					if (pi_values[a] > w && pi_values[b] <= w)
-					{
-						tmp += e->weight;
-						cut.push_back(e->id);
-						if (e->red)
-						{
-							++n_proc;
-						}
-					}
-				}
-				if (tmp > ma && n_proc <= p_max)
-				{
-					S.clear();
-					T.clear();
-					ma = tmp;
-					for (int i = 0; i < n; ++i)
-					{
-						if (pi_values[i] > w)
-						{
-							S.push_back(i);
-						}
-						else
-						{
-							T.push_back(i);
-						}
-					}
-				}
-				
+				if (in_S[e->id_from] && !in_S[e->id_to])
+					value += e->weight;
 			}
-			res = ma;
+			// At a limit, the solver may return a cut worse than the start
+			if (value >= start_value)
+				reduced_S = ilp_S;
 		}
+		else if (lp_S.empty())
+			return err;
+		else if (stats)
+			stats->method = "lp"; // the rounding, with the bound of the LP
 	}
-	catch (GRBException e)
+
+	double start = wall_time();
+	if (!reduced_S.empty())
+		reduction.expand(reduced_S, cut, S, T, res);
+	else
+		res = 0; // no rounding has at most p_max red edges
+	bound = max(bound, res);
+	if (stats)
 	{
-		std::cerr << "GRB Error : " << e.getMessage() <<  e.getErrorCode() << " int ? " << integral << '\n';
-		return 1;
+		stats->rounding_time += wall_time() - start;
+		stats->mip_gap = (res > 0) ? (bound - res) / res : 0;
 	}
+	report(res, bound);
 	return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @private
+ *  Compute the maximum topological cut of a DAG stored as a Graph, as described in IPDPS'18
+ * 
+ * @param graph	the DAG in Graph format
+ * @param cut 	vector that will contain the edges of the cut
+ * @param S 	vector that will contain the S set after the cut
+ * @param T		vector that will contain the T set after the cut
+ * @param res 	double where the max cut value will be stored
+ * @param stats 	if not null, filled with the timings and solver statistics
+ *
+ *
+ * @return 0 if everything went well, then the result is in the last arg. 1 if there was an error in gurobi.
+ */
+int get_maxcut_lin(const Graph &graph,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double & res, SolverStats *stats)
+{
+	PMaxcutSession session(graph);
+	return session.maxcut(cut, S, T, res, stats);
+}
+
+/**
+ * @private
+ *  Compute the p-maximum topological cut of a DAG stored as a Graph, as described in my APCDM
+ *  To solve the same graph for several values of p, use a PMaxcutSession.
+ * 
+ * @param graph	the DAG in Graph format
+ * @param p_max 	value of p
+ * @param cut 	vector that will contain the edges of the cut
+ * @param S 	vector that will contain the S set after the cut
+ * @param T		vector that will contain the T set after the cut
+ * @param res 	double where the max cut value will be stored
+ * @param integral 	true iff we want to solve the ILP, otherwise solve fractional relaxation
+ * @param stats 	if not null, filled with the timings and solver statistics
+ *
+ *
+ * @return 0 if everything went well, then the result is in the last arg. 1 if there was an error in gurobi.
+ */
+int get_p_maxcut_lin(const Graph &graph, int p_max,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double & res, bool integral, SolverStats *stats)
+{
+	PMaxcutSession session(graph);
+	return session.p_maxcut(p_max, cut, S, T, res, integral, stats);
+}
+
+/**
+ * @private
+ *  Compute the p-maximum topological cut of a DAG stored as a Graph within a budget of time or
+ *  of branch and bound nodes (see PMaxcutSession::p_maxcut_anytime).
+ *
+ * @param graph	the DAG in Graph format
+ * @param p_max 	value of p
+ * @param options 	limits of the solve, and callback of the improving cuts and bounds
+ * @param cut 	vector that will contain the edges of the best cut found
+ * @param S 	vector that will contain the S set after the cut
+ * @param T		vector that will contain the T set after the cut
+ * @param res 	double where the value of the best cut found will be stored
+ * @param bound 	double where the best proven upper bound will be stored
+ * @param stats 	if not null, filled with the timings and solver statistics (and the gap between res and bound)
+ *
+ *
+ * @return 0 if everything went well, even if a limit was reached. 1 if there was an error in gurobi.
+ */
+int get_p_maxcut_anytime(const Graph &graph, int p_max, const AnytimeOptions &options,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res, double &bound, SolverStats *stats)
+{
+	PMaxcutSession session(graph);
+	return session.p_maxcut_anytime(p_max, options, cut, S, T, res, bound, stats);
+}
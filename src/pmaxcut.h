@@ -1,21 +1,140 @@
 #pragma once
 
 #include "graph.h"
+#include "csr.h"
+#include "reduce.h"
 #include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
 
 /* The following definition allows this code to be used in C code */
 #ifdef __cplusplus
 extern "C" {  
 #endif 
 
+/* A topological cut, as a breakpoint of the LP value of the p-maxcut as a function of p */
+struct PMaxcutBreakpoint
+{
+	int red;			// number of red edges in the cut
+	double weight;		// weight of the cut
+	std::vector<int> S;	// S set of the cut
+};
+
+/* Statistics of one solve, recorded when the solver is given a SolverStats
+ * (the default null pointer records nothing)
+ */
+struct SolverStats
+{
+	const char *method = "";	// "lp", "ilp", "tree", "sp", or "rounded" if the rounding of the LP was optimal
+								// ("lp" for an ILP without ILP solver, see PMaxcutSession)
+	int n_vertices = 0;			// size of the graph given to the solver, after reduction
+	int n_edges = 0;
+	double build_time = 0;		// construction of the reduction and of the model (s)
+	double solve_time = 0;		// solver or dynamic program (s)
+	double rounding_time = 0;	// extraction or rounding of the cut, expansion to the original graph (s)
+	double iterations = 0;		// simplex iterations (max-flows for the flow backend)
+	double nodes = 0;			// branch and bound nodes (ILP)
+	double mip_gap = 0;			// relative gap of the ILP (or of the rounded LP)
+};
+
+/* Budget of an anytime solve of the ILP (see PMaxcutSession::p_maxcut_anytime) : when a limit
+ * is reached, the solve stops with the best cut found and the best proven upper bound.
+ */
+struct AnytimeOptions
+{
+	double time_limit = 0;	// wall-clock time from the start of the solve (s), 0 for no limit
+	double node_limit = 0;	// branch and bound nodes, 0 for no limit
+	// if not empty, called when the best cut value (incumbent) or the bound improves,
+	// with the time since the start of the solve (s)
+	std::function<void(double incumbent, double bound, double elapsed)> progress;
+};
+
 
 int get_maxcut_lin(const Graph &graph,
-		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res);
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, SolverStats *stats = nullptr);
 
 
 int get_p_maxcut_lin(const Graph &graph, int p_max, 
-		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, bool integer = false);
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, bool integer = false,
+		SolverStats *stats = nullptr);
+
+
+int get_p_maxcut_anytime(const Graph &graph, int p_max, const AnytimeOptions &options,
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, double &bound,
+		SolverStats *stats = nullptr);
+
+
+void set_solver_threads(int n_threads);
+
+int set_solver_backend(const char *name);
+
+
+int get_maxcut_flow(const Graph &graph,
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res);
+
+int get_maxcut_flow_csr(const CSRGraph &graph,
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res);
+
+int get_maxcut_parallel(const CSRGraph &graph,
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, int n_threads = 0);
+
+void round_p_maxcut(const Graph &graph, const std::vector<double> &pi_values, int p_max,
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res);
+
+int get_p_maxcut_sweep(const Graph &graph, std::vector<PMaxcutBreakpoint> &breakpoints, std::vector<double> &values);
+
+int get_p_maxcut_lagrangian(const Graph &graph, int p_max,
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, double &bound);
+
+int get_p_maxcut_tree(const Graph &graph, int p_max,
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, std::vector<double> *values = nullptr);
+
+int get_p_maxcut_sp(const Graph &graph, int p_max,
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, std::vector<double> *values = nullptr);
+
+int get_p_maxcut_heuristic(const Graph &graph, int p_max,
+		std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res,
+		int n_restarts = 8, uint64_t seed = 0, int n_threads = 0);
 
 #ifdef __cplusplus  
 } // extern "C"  
 #endif
+
+
+class CutBackend;
+
+/* Solver session on one graph, to solve it for several values of p
+ *
+ * The LP/ILP backend (see backend.h) is built once on the reduced graph (see GraphReduction),
+ * and solves the LP for each value of p. The cuts are expanded back to the original graph.
+ */
+class PMaxcutSession
+{
+private:
+	double build_time;	// initialized first, to include the reduction
+	GraphReduction reduction;
+	std::unique_ptr<CutBackend> backend;
+	int error;
+
+	// Last LP solved, with its best rounding on the reduced graph
+	int lp_p_max;
+	double lp_bound, lp_res;
+	std::vector<int> lp_S;
+
+	int relaxation(int p_max, SolverStats *stats);
+	int integral_cut(int p_max, const AnytimeOptions *options,
+			std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, double &bound, SolverStats *stats);
+	void record_stats(SolverStats *stats, const char *method);
+
+public:
+	PMaxcutSession(const Graph &graph);
+	~PMaxcutSession();
+
+	int maxcut(std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, SolverStats *stats = nullptr);
+	int p_maxcut(int p_max, std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, bool integral = false,
+			SolverStats *stats = nullptr);
+	int p_maxcut_anytime(int p_max, const AnytimeOptions &options,
+			std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res, double &bound,
+			SolverStats *stats = nullptr);
+};
@@ -0,0 +1,191 @@
+#include "reach.h"
+#include <vector>
+#include <algorithm>
+#include <random>
+
+using namespace std;
+
+/* This file contains the reachability index of DAGs
+ */
+
+/* Builds the index of a DAG.
+ *
+ * @param graph 			 the DAG, in CSR format
+ * @param max_closure_bytes  the transitive closure is used iff it fits in this many bytes
+ * @param n_labels 			 number of GRAIL labels per vertex, if the closure is not used
+ */
+ReachabilityIndex::ReachabilityIndex(const CSRGraph &graph, size_t max_closure_bytes /*= DEFAULT_MAX_CLOSURE_BYTES*/, int n_labels /*= 2*/)
+	: graph(graph), words(0), n_labels(n_labels), stamp(0)
+{
+	uint32_t n = graph.n;
+
+	// Topological order (Kahn)
+	vector<uint32_t> order, in_degree(n);
+	order.reserve(n);
+	for (uint32_t v = 0; v < n; ++v)
+	{
+		in_degree[v] = graph.in_degree(v);
+		if (in_degree[v] == 0)
+			order.push_back(v);
+	}
+	for (size_t k = 0; k < order.size(); ++k)
+	{
+		uint32_t v = order[k];
+		for (uint32_t i = graph.out_offsets[v]; i < graph.out_offsets[v + 1]; ++i)
+		{
+			if (--in_degree[graph.out_heads[i]] == 0)
+				order.push_back(graph.out_heads[i]);
+		}
+	}
+
+	size_t row_words = (n + 63) / 64;
+	if (row_words * n * sizeof(uint64_t) <= max_closure_bytes)
+	{
+		words = max(row_words, (size_t)1);
+		closure.assign(words * n, 0);
+		for (size_t k = n; k-- > 0;)
+		{
+			uint32_t v = order[k];
+			uint64_t *row = &closure[v * words];
+			for (uint32_t i = graph.out_offsets[v]; i < graph.out_offsets[v + 1]; ++i)
+			{
+				uint32_t w = graph.out_heads[i];
+				const uint64_t *succ = &closure[w * words];
+				for (size_t j = 0; j < words; ++j)
+					row[j] |= succ[j];
+				row[w / 64] |= (uint64_t)1 << (w % 64);
+			}
+		}
+		return;
+	}
+
+	// Topological levels
+	level.assign(n, 0);
+	for (uint32_t v : order)
+	{
+		for (uint32_t i = graph.out_offsets[v]; i < graph.out_offsets[v + 1]; ++i)
+		{
+			uint32_t w = graph.out_heads[i];
+			level[w] = max(level[w], level[v] + 1);
+		}
+	}
+
+	// GRAIL labels : iterative DFS from the roots, children in random order
+	low.assign((size_t)n * n_labels, 0);
+	post.assign((size_t)n * n_labels, 0);
+	pre.assign(n, 0);
+	mark.assign(n, 0);
+	mt19937 rng(0);
+	vector<uint32_t> roots, children;
+	vector<pair<uint32_t,uint32_t>> stack; // vertex, index of the next child in children
+	vector<uint32_t> child_begin(n);
+	for (uint32_t v = 0; v < n; ++v)
+	{
+		if (graph.in_degree(v) == 0)
+			roots.push_back(v);
+	}
+
+	for (int l = 0; l < n_labels; ++l)
+	{
+		++stamp;
+		shuffle(roots.begin(), roots.end(), rng);
+		uint32_t rank = 0, pre_rank = 0;
+		children.clear();
+		for (uint32_t r : roots)
+		{
+			stack.push_back(make_pair(r, 0));
+			mark[r] = stamp;
+			if (l == 0)
+				pre[r] = pre_rank++;
+			child_begin[r] = children.size();
+			children.insert(children.end(), graph.out_heads + graph.out_offsets[r], graph.out_heads + graph.out_offsets[r + 1]);
+			shuffle(children.begin() + child_begin[r], children.end(), rng);
+			low[(size_t)r * n_labels + l] = UINT32_MAX;
+
+			while (!stack.empty())
+			{
+				uint32_t v = stack.back().first;
+				uint32_t k = stack.back().second;
+				if (k < (uint32_t)graph.out_degree(v))
+				{
+					++stack.back().second;
+					uint32_t w = children[child_begin[v] + k];
+					if (mark[w] != stamp)
+					{
+						mark[w] = stamp;
+						if (l == 0)
+							pre[w] = pre_rank++;
+						low[(size_t)w * n_labels + l] = UINT32_MAX;
+						child_begin[w] = children.size();
+						children.insert(children.end(), graph.out_heads + graph.out_offsets[w], graph.out_heads + graph.out_offsets[w + 1]);
+						shuffle(children.begin() + child_begin[w], children.end(), rng);
+						stack.push_back(make_pair(w, 0));
+					}
+					continue;
+				}
+
+				// All the descendants of v have their label
+				stack.pop_back();
+				uint32_t &v_low = low[(size_t)v * n_labels + l];
+				post[(size_t)v * n_labels + l] = rank;
+				v_low = min(v_low, rank);
+				++rank;
+				for (uint32_t i = graph.out_offsets[v]; i < graph.out_offsets[v + 1]; ++i)
+					v_low = min(v_low, low[(size_t)graph.out_heads[i] * n_labels + l]);
+			}
+		}
+	}
+}
+
+// True iff the intervals of b are contained in the intervals of a
+inline bool ReachabilityIndex::contains(uint32_t a, uint32_t b) const
+{
+	if (level[a] >= level[b]) return false;
+	for (int l = 0; l < n_labels; ++l)
+	{
+		size_t ia = (size_t)a * n_labels + l, ib = (size_t)b * n_labels + l;
+		if (low[ib] < low[ia] || post[ib] > post[ia]) return false;
+	}
+	return true;
+}
+
+// True iff a is a proper ancestor of b in the tree of the first traversal
+inline bool ReachabilityIndex::tree_ancestor(uint32_t a, uint32_t b) const
+{
+	return a != b && pre[a] <= pre[b] && post[(size_t)b * n_labels] <= post[(size_t)a * n_labels];
+}
+
+/* @return true iff there is a path (of at least one edge) from a to b
+ */
+bool ReachabilityIndex::path_exists(int a, int b) const
+{
+	if (uses_closure())
+		return (closure[(size_t)a * words + b / 64] >> (b % 64)) & 1;
+
+	if (!contains(a, b)) return false;
+	if (tree_ancestor(a, b)) return true;
+
+	// Pruned DFS
+	if (++stamp == 0)
+	{
+		fill(mark.begin(), mark.end(), 0);
+		stamp = 1;
+	}
+	vector<uint32_t> stack(1, a);
+	while (!stack.empty())
+	{
+		uint32_t u = stack.back();
+		stack.pop_back();
+		for (uint32_t i = graph.out_offsets[u]; i < graph.out_offsets[u + 1]; ++i)
+		{
+			uint32_t w = graph.out_heads[i];
+			if (w == (uint32_t)b || tree_ancestor(w, b)) return true;
+			if (mark[w] != stamp && contains(w, b))
+			{
+				mark[w] = stamp;
+				stack.push_back(w);
+			}
+		}
+	}
+	return false;
+}
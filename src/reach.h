@@ -0,0 +1,52 @@
+#pragma once
+
+#include "csr.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/* Reachability index of a DAG, built once to answer many path queries
+ *
+ * Two representations, chosen by the size of the graph :
+ *  - transitive closure : one bitset of descendants per vertex, built by OR-ing the bitsets
+ *    of the successors in reverse topological order. O(1) queries, n^2 / 8 bytes ;
+ *  - GRAIL labels : for a few random DFS traversals, the interval [min post order of the
+ *    descendants, post order] of each vertex, and the topological level. A query whose
+ *    intervals are not nested is answered in O(1), the other ones by a DFS that prunes the
+ *    vertices whose intervals don't contain the target, and stops at a vertex that is an
+ *    ancestor of the target in the tree of the first traversal (pre and post orders). O(n) memory.
+ *
+ * Queries on an index that uses GRAIL labels are not thread safe (they share the marks of the DFS).
+ */
+class ReachabilityIndex
+{
+private:
+	CSRGraph graph;
+
+	// Transitive closure
+	size_t words;					// words per row, 0 if the closure is not used
+	std::vector<uint64_t> closure;
+
+	// GRAIL labels
+	int n_labels;
+	std::vector<uint32_t> level;
+	std::vector<uint32_t> low, post;	// n_labels entries per vertex
+	std::vector<uint32_t> pre;			// pre order in the first traversal
+	mutable std::vector<uint32_t> mark;
+	mutable uint32_t stamp;
+
+	bool contains(uint32_t a, uint32_t b) const;
+	bool tree_ancestor(uint32_t a, uint32_t b) const;
+
+public:
+	static const size_t DEFAULT_MAX_CLOSURE_BYTES = (size_t)1 << 25;
+
+	ReachabilityIndex(const CSRGraph &graph, size_t max_closure_bytes = DEFAULT_MAX_CLOSURE_BYTES, int n_labels = 2);
+
+	bool path_exists(int a, int b) const;
+
+	inline bool uses_closure() const
+	{
+		return words != 0;
+	}
+};
@@ -0,0 +1,234 @@
+#include "reduce.h"
+#include "reach.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+/* This file contains the reduction of graphs before cut solving
+ */
+
+// Working multigraph of the reduction
+struct ReductionArcs
+{
+	int source, target;
+	vector<int> from, to, red;
+	vector<double> weight;
+	vector<bool> alive;
+	vector<vector<int>> out_arcs, in_arcs;	// lazy deletion of the dead arcs
+	vector<int> out_degree, in_degree;
+	unordered_map<uint64_t, int> arc_between;	// last arc added between two vertices
+
+	ReductionArcs(int n, int source, int target) : source(source), target(target),
+		out_arcs(n), in_arcs(n), out_degree(n, 0), in_degree(n, 0) {}
+
+	static uint64_t key(int a, int b)
+	{
+		return ((uint64_t)a << 32) | (uint32_t)b;
+	}
+
+	// Adds an arc, unless it doesn't constrain the cut, and merges it with a parallel arc if possible
+	void add(int a, int b, double w, int r)
+	{
+		if (w == 0 && r == 0 && (a == source || b == target)) return;
+
+		auto it = arc_between.find(key(a, b));
+		if (it != arc_between.end() && red[it->second] + r <= 1)
+		{
+			weight[it->second] += w;
+			red[it->second] += r;
+			return;
+		}
+
+		int arc = from.size();
+		arc_between[key(a, b)] = arc;
+		out_arcs[a].push_back(arc);
+		in_arcs[b].push_back(arc);
+		from.push_back(a);
+		to.push_back(b);
+		weight.push_back(w);
+		red.push_back(r);
+		alive.push_back(true);
+		++out_degree[a];
+		++in_degree[b];
+	}
+
+	void remove(int arc)
+	{
+		alive[arc] = false;
+		--out_degree[from[arc]];
+		--in_degree[to[arc]];
+		auto it = arc_between.find(key(from[arc], to[arc]));
+		if (it != arc_between.end() && it->second == arc)
+			arc_between.erase(it);
+	}
+
+	// First alive arc of a list, the dead arcs before it are removed
+	int first_alive(vector<int> &arcs)
+	{
+		size_t k = 0;
+		while (!alive[arcs[k]])
+			++k;
+		arcs.erase(arcs.begin(), arcs.begin() + k);
+		return arcs[0];
+	}
+};
+
+/* Reduces a graph. The graph must outlive the reduction.
+ * If the source or the target is not set, the graph is copied without reduction.
+ */
+GraphReduction::GraphReduction(const Graph &graph) : graph(graph)
+{
+	int n = graph.n_vertices();
+	int source = graph.source_id, target = graph.target_id;
+	new_id.assign(n, -1);
+
+	if (source == -1 || target == -1)
+	{
+		reduced = graph;
+		for (int v = 0; v < n; ++v)
+			new_id[v] = v;
+		return;
+	}
+
+	// Edges of null weight that are not red, implied by a path through another successor
+	vector<bool> transitive(graph.n_edges(), false);
+	bool candidates = false;
+	for (auto e : graph.edges)
+		candidates = candidates || (e->weight == 0 && !e->red);
+	if (candidates)
+	{
+		CSRGraph csr(graph);
+		ReachabilityIndex index(csr);
+		for (auto e : graph.edges)
+		{
+			if (e->weight != 0 || e->red || e->id_from == source || e->id_to == target) continue;
+			int a = e->id_from, b = e->id_to;
+			for (uint32_t i = csr.out_offsets[a]; i < csr.out_offsets[a + 1] && !transitive[e->id]; ++i)
+			{
+				int c = csr.out_heads[i];
+				transitive[e->id] = c != b && index.path_exists(c, b);
+			}
+		}
+	}
+
+	ReductionArcs arcs(n, source, target);
+	for (auto e : graph.edges)
+	{
+		if (!transitive[e->id])
+			arcs.add(e->id_from, e->id_to, e->weight, e->red);
+	}
+
+	vector<int> todo;
+	for (int v = n - 1; v >= 0; --v)
+		todo.push_back(v);
+	vector<bool> removed(n, false);
+	while (!todo.empty())
+	{
+		int v = todo.back();
+		todo.pop_back();
+		if (removed[v] || v == source || v == target || arcs.in_degree[v] != 1 || arcs.out_degree[v] != 1) continue;
+
+		int a = arcs.first_alive(arcs.in_arcs[v]), b = arcs.first_alive(arcs.out_arcs[v]);
+		int u = arcs.from[a], w = arcs.to[b];
+		int kept;
+		if (arcs.weight[a] >= arcs.weight[b] && arcs.red[a] <= arcs.red[b])
+		{
+			kept = a; // cutting the chain cuts u -> v : v is on the side of w
+			contracted.push_back(make_pair(v, w));
+		}
+		else if (arcs.weight[b] >= arcs.weight[a] && arcs.red[b] <= arcs.red[a])
+		{
+			kept = b; // v is on the side of u
+			contracted.push_back(make_pair(v, u));
+		}
+		else
+		{
+			continue;
+		}
+
+		double kept_weight = arcs.weight[kept];
+		int kept_red = arcs.red[kept];
+		arcs.remove(a);
+		arcs.remove(b);
+		removed[v] = true;
+		arcs.add(u, w, kept_weight, kept_red);
+		todo.push_back(u);
+		todo.push_back(w);
+	}
+
+	// Vertices left without edges (their edges didn't constrain the cut) go to T
+	for (int v = 0; v < n; ++v)
+	{
+		if (!removed[v] && v != source && v != target && arcs.in_degree[v] == 0 && arcs.out_degree[v] == 0)
+		{
+			removed[v] = true;
+			contracted.push_back(make_pair(v, target));
+		}
+	}
+
+	int n_arcs = 0;
+	for (size_t k = 0; k < arcs.from.size(); ++k)
+		n_arcs += arcs.alive[k];
+	reduced.reserve(n - contracted.size(), n_arcs);
+	for (int v = 0; v < n; ++v)
+	{
+		if (!removed[v])
+			new_id[v] = reduced.add_vertex(graph.vertices[v].time, graph.vertices[v].memory);
+	}
+	for (size_t k = 0; k < arcs.from.size(); ++k)
+	{
+		if (arcs.alive[k])
+			reduced.add_edge(new_id[arcs.from[k]], new_id[arcs.to[k]], arcs.weight[k], arcs.red[k] != 0);
+	}
+	reduced.source_id = new_id[source];
+	reduced.target_id = new_id[target];
+}
+
+/* Expands a cut of the reduced graph to the original graph
+ *
+ * @param reduced_S S set of the cut in the reduced graph
+ * @param cut 		vector that will contain the edges of the cut in the original graph
+ * @param S 		vector that will contain the S set after the cut
+ * @param T			vector that will contain the T set after the cut
+ * @param res 		double where the value of the cut will be stored
+ */
+void GraphReduction::expand(const vector<int> &reduced_S,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res) const
+{
+	int n = graph.n_vertices();
+	vector<bool> reduced_in_S(reduced.n_vertices(), false);
+	for (int v : reduced_S)
+		reduced_in_S[v] = true;
+
+	vector<bool> in_S(n, false);
+	for (int v = 0; v < n; ++v)
+	{
+		if (new_id[v] != -1)
+			in_S[v] = reduced_in_S[new_id[v]];
+	}
+	// A vertex takes the side of a vertex contracted after it, or still in the reduced graph
+	for (auto it = contracted.rbegin(); it != contracted.rend(); ++it)
+		in_S[it->first] = in_S[it->second];
+
+	cut.clear();
+	S.clear();
+	T.clear();
+	res = 0;
+	for (auto e : graph.edges)
+	{
+		if (in_S[e->id_from] && !in_S[e->id_to])
+		{
+			res += e->weight;
+			cut.push_back(e->id);
+		}
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		if (in_S[i])
+			S.push_back(i);
+		else
+			T.push_back(i);
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "graph.h"
+#include <vector>
+
+/* Reduction of a DAG before cut solving
+ *
+ * The reduced graph has the same p-maxcut values (LP and ILP) as the original one, for all p :
+ *  - the edges of null weight that are not red and leave the source or enter the target are
+ *    removed, they don't constrain the cut ;
+ *  - the edges of null weight that are not red and are implied by a longer path are removed
+ *    (checked with a ReachabilityIndex) ;
+ *  - parallel edges are merged (sum of the weights), if at most one of them is red ;
+ *  - a vertex with one incoming edge and one outgoing edge is contracted when one of the two
+ *    edges dominates the other (heavier and not more red edges) : any cut through the chain
+ *    can cut the dominating edge, which is kept between the ends of the chain.
+ * The rules are applied until none applies.
+ *
+ * A contracted vertex is on the same side of the cut as one of the ends of its chain,
+ * so a cut of the reduced graph is expanded to a cut of the original graph of the same weight
+ * and number of red edges.
+ */
+class GraphReduction
+{
+private:
+	const Graph &graph;
+	std::vector<int> new_id;					// id in the reduced graph, -1 if contracted
+	std::vector<std::pair<int,int>> contracted;	// contracted vertices (in order), with the vertex whose side they take
+
+public:
+	Graph reduced;
+
+	GraphReduction(const Graph &graph);
+
+	void expand(const std::vector<int> &reduced_S,
+			std::vector<int> &cut, std::vector<int> &S, std::vector<int> &T, double &res) const;
+};
@@ -0,0 +1,150 @@
+#include "results.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+
+/* This file contains the CSV stream of results
+ */
+
+static const char *HEADER = "file,p,mode,value,error,method,n,m,build_s,solve_s,round_s,iterations,nodes,mip_gap";
+
+// The methods of SolverStats (and "flow" for the maxcut), as string literals
+static const char *method_literal(const string &method)
+{
+	for (const char *m : {"lp", "ilp", "tree", "sp", "rounded", "flow"})
+	{
+		if (method == m) return m;
+	}
+	return "";
+}
+
+static string csv_field(const string &s)
+{
+	if (s.find_first_of(",\"\n") == string::npos) return s;
+	string res = "\"";
+	for (char c : s)
+	{
+		if (c == '"') res += '"';
+		res += c;
+	}
+	return res + "\"";
+}
+
+static vector<string> split_csv(const string &line)
+{
+	vector<string> fields(1);
+	bool quoted = false;
+	for (size_t i = 0; i < line.size(); ++i)
+	{
+		char c = line[i];
+		if (quoted && c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+		{
+			fields.back() += c;
+			++i;
+		}
+		else if (c == '"')
+			quoted = !quoted;
+		else if (c == ',' && !quoted)
+			fields.emplace_back();
+		else
+			fields.back() += c;
+	}
+	return fields;
+}
+
+static bool parse_record(const string &line, ResultRecord &res)
+{
+	vector<string> f = split_csv(line);
+	if (f.size() != 14) return false;
+	try
+	{
+		res.file = f[0];
+		res.p = stoi(f[1]);
+		res.mode = f[2];
+		res.value = stod(f[3]);
+		res.error = stoi(f[4]);
+		res.stats.method = method_literal(f[5]);
+		res.stats.n_vertices = stoi(f[6]);
+		res.stats.n_edges = stoi(f[7]);
+		res.stats.build_time = stod(f[8]);
+		res.stats.solve_time = stod(f[9]);
+		res.stats.rounding_time = stod(f[10]);
+		res.stats.iterations = stod(f[11]);
+		res.stats.nodes = stod(f[12]);
+		res.stats.mip_gap = stod(f[13]);
+	}
+	catch (logic_error &e) // invalid_argument or out_of_range
+	{
+		return false;
+	}
+	return true;
+}
+
+/* Opens a results file, and loads its records without error if it exists.
+ * A last line without its end of line (the write was interrupted) is removed from the file.
+ *
+ * @param filename 	Name of the CSV file
+ */
+ResultsSink::ResultsSink(const string &filename)
+{
+	size_t complete = 0; // size of the complete lines
+	bool partial = false;
+	{
+		ifstream in(filename, ios::binary);
+		stringstream content;
+		content << in.rdbuf();
+		string text = content.str();
+
+		size_t start = 0, end;
+		while ((end = text.find('\n', start)) != string::npos)
+		{
+			ResultRecord record;
+			// A failed solve is computed again, its new record is appended after this one
+			if (parse_record(text.substr(start, end - start), record) && record.error == 0)
+				done[make_tuple(record.file, record.p, record.mode)] = record;
+			start = end + 1;
+		}
+		complete = start;
+		if (complete < text.size() && truncate(filename.c_str(), complete) != 0)
+			partial = true; // the partial line stays, start a new one after it
+	}
+
+	out = fopen(filename.c_str(), "a");
+	if (out == nullptr) return;
+	if (partial)
+		fprintf(out, "\n");
+	if (complete == 0)
+		fprintf(out, "%s\n", HEADER);
+	fflush(out);
+}
+
+ResultsSink::~ResultsSink()
+{
+	if (out) fclose(out);
+}
+
+/* @return true iff the record of (file, p, mode) was loaded when the file was opened, then it is copied in res
+ */
+bool ResultsSink::find(const string &file, int p, const string &mode, ResultRecord &res) const
+{
+	auto it = done.find(make_tuple(file, p, mode));
+	if (it == done.end()) return false;
+	res = it->second;
+	return true;
+}
+
+void ResultsSink::write(const ResultRecord &record)
+{
+	if (out == nullptr) return;
+	const SolverStats &s = record.stats;
+
+	lock_guard<mutex> guard(lock);
+	fprintf(out, "%s,%d,%s,%.17g,%d,%s,%d,%d,%.6g,%.6g,%.6g,%.17g,%.17g,%.6g\n",
+		csv_field(record.file).c_str(), record.p, csv_field(record.mode).c_str(), record.value, record.error,
+		s.method, s.n_vertices, s.n_edges, s.build_time, s.solve_time, s.rounding_time, s.iterations, s.nodes, s.mip_gap);
+	fflush(out);
+}
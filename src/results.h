@@ -0,0 +1,54 @@
+#pragma once
+
+#include "pmaxcut.h"
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+/* Results of the experiments, written as a CSV stream
+ *
+ * There is one record per (file, p, mode), mode being "maxcut", "lp" or "ilp" (p is 0 for the maxcut).
+ * Each record is appended and flushed as soon as it is computed, so the file is also the checkpoint
+ * of the run : a run restarted on the same file loads the complete records and only computes the others.
+ * Records with a non zero error are not loaded, so the failed solves are computed again.
+ * A last line cut by a crash is dropped when the file is reopened.
+ *
+ * Columns : file,p,mode,value,error,method,n,m,build_s,solve_s,round_s,iterations,nodes,mip_gap
+ * (the statistics are those of SolverStats, see pmaxcut.h ; the maxcut only records its method "flow",
+ * the size of the graph and its solve time).
+ */
+
+struct ResultRecord
+{
+	std::string file;
+	int p = 0;
+	std::string mode;
+	double value = -1;
+	int error = 0;		// return code of the solver
+	SolverStats stats;	// stats.method always points to a string literal
+};
+
+class ResultsSink
+{
+private:
+	FILE *out;
+	std::mutex lock;
+	std::map<std::tuple<std::string, int, std::string>, ResultRecord> done;
+
+public:
+	ResultsSink(const std::string &filename);
+	~ResultsSink();
+
+	ResultsSink(const ResultsSink&) = delete;
+	ResultsSink& operator=(const ResultsSink&) = delete;
+
+	bool is_open() const { return out != nullptr; }
+	int n_loaded() const { return done.size(); }
+
+	// Records without error loaded when the file was opened, thread safe
+	bool find(const std::string &file, int p, const std::string &mode, ResultRecord &res) const;
+	// Appends and flushes a record, thread safe
+	void write(const ResultRecord &record);
+};
@@ -0,0 +1,178 @@
+#include "pmaxcut.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/* This file contains the rounding of fractional solutions of the p-maxcut LP
+ */
+
+// Weight of the cut obtained with threshold w, summed in the order of the edges
+static double threshold_weight(const Graph &graph, const vector<double> &pi_values, double w)
+{
+	double res = 0;
+	for (auto e : graph.edges)
+	{
+		if (pi_values[e->id_from] > w && pi_values[e->id_to] <= w)
+			res += e->weight;
+	}
+	return res;
+}
+
+/**
+ * @private
+ *  Find the best threshold rounding of a fractional solution of the p-maxcut LP.
+ *  The candidate thresholds are the values of pi (and 0, 1), minus 1e-6 to avoid rounding
+ *  errors : S = {v, pi_v > w}. Among the cuts with at most p_max red edges, the heaviest
+ *  one is kept (the first candidate in the order of pi_values in case of a tie).
+ *
+ *  The thresholds are swept in decreasing order, and the weight and the number of red
+ *  edges of the cut are updated as each edge enters (w < pi_from) and leaves (w < pi_to)
+ *  the cut : O((n + m) log(n + m)) instead of one pass over the edges per threshold.
+ *
+ * @param graph		the DAG in Graph format
+ * @param pi_values value of the variable of each vertex in the fractional solution
+ * @param p_max 	value of p
+ * @param cut 		vector that will contain the edges of the cut
+ * @param S 		vector that will contain the S set after the cut
+ * @param T			vector that will contain the T set after the cut
+ * @param res 		double where the value of the cut will be stored (0 if no cut was found)
+ */
+void round_p_maxcut(const Graph &graph, const vector<double> &pi_values, int p_max,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res)
+{
+	int n = graph.n_vertices();
+	cut.clear();
+	S.clear();
+	T.clear();
+
+	// Candidate thresholds, with the index of their first occurrence
+	vector<pair<double,int>> thresholds;
+	for (int i = 0; i < n; ++i)
+		thresholds.push_back(make_pair(pi_values[i] - 1e-6, i));
+	thresholds.push_back(make_pair((0 + __DBL_EPSILON__) - 1e-6, n));
+	thresholds.push_back(make_pair((1 - __DBL_EPSILON__) - 1e-6, n + 1));
+	sort(thresholds.begin(), thresholds.end(), [](const pair<double,int> &a, const pair<double,int> &b)
+	{
+		return (a.first != b.first) ? a.first > b.first : a.second < b.second;
+	});
+
+	// Edge events : an edge is in the cut iff pi_to <= w < pi_from
+	vector<Edge*> enter, leave;
+	double total = 0;
+	for (auto e : graph.edges)
+	{
+		total += fabs(e->weight);
+		if (pi_values[e->id_from] > pi_values[e->id_to])
+		{
+			enter.push_back(e);
+			leave.push_back(e);
+		}
+	}
+	sort(enter.begin(), enter.end(), [&](Edge *a, Edge *b) { return pi_values[a->id_from] > pi_values[b->id_from]; });
+	sort(leave.begin(), leave.end(), [&](Edge *a, Edge *b) { return pi_values[a->id_to] > pi_values[b->id_to]; });
+
+	// The incremental weight is only an estimate : when it is too close to the best one
+	// to decide, the exact weight (same summation order as a direct computation) is used.
+	double margin = 1e-12 * max(1.0, total);
+	long double weight = 0;
+	int n_proc = 0;
+	size_t next_enter = 0, next_leave = 0;
+
+	int best = -1;				// index of the best threshold in thresholds
+	long double best_estimate = 0;
+	double best_exact = 0;
+	bool best_exact_known = true; // the initial best is the empty cut, of weight 0
+	bool changed = true;		// edges entered or left the cut since the best threshold
+
+	for (size_t k = 0; k < thresholds.size(); ++k)
+	{
+		double w = thresholds[k].first;
+		if (k > 0 && w == thresholds[k - 1].first) continue; // same cut, later occurrence
+
+		while (next_enter < enter.size() && pi_values[enter[next_enter]->id_from] > w)
+		{
+			weight += enter[next_enter]->weight;
+			n_proc += enter[next_enter]->red;
+			++next_enter;
+			changed = true;
+		}
+		while (next_leave < leave.size() && pi_values[leave[next_leave]->id_to] > w)
+		{
+			weight -= leave[next_leave]->weight;
+			n_proc -= leave[next_leave]->red;
+			++next_leave;
+			changed = true;
+		}
+
+		if (n_proc > p_max) continue;
+
+		bool better;
+		if (!changed)
+		{
+			// Exactly the same cut as the best one
+			if (thresholds[k].second < thresholds[best].second)
+				best = k;
+			continue;
+		}
+		else if (weight > best_estimate + margin)
+		{
+			better = true;
+		}
+		else if (weight < best_estimate - margin)
+		{
+			better = false;
+		}
+		else
+		{
+			if (!best_exact_known)
+			{
+				best_exact = threshold_weight(graph, pi_values, thresholds[best].first);
+				best_exact_known = true;
+			}
+			double exact = threshold_weight(graph, pi_values, w);
+			if (exact != best_exact)
+				better = exact > best_exact;
+			else
+				better = (best != -1) && thresholds[k].second < thresholds[best].second;
+
+			if (better)
+			{
+				best = k;
+				best_estimate = weight;
+				best_exact = exact;
+				changed = false;
+			}
+			continue;
+		}
+
+		if (better)
+		{
+			best = k;
+			best_estimate = weight;
+			best_exact_known = false;
+			changed = false;
+		}
+	}
+
+	res = 0;
+	if (best == -1) return;
+
+	double w = thresholds[best].first;
+	for (auto e : graph.edges)
+	{
+		if (pi_values[e->id_from] > w && pi_values[e->id_to] <= w)
+		{
+			res += e->weight;
+			cut.push_back(e->id);
+		}
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		if (pi_values[i] > w)
+			S.push_back(i);
+		else
+			T.push_back(i);
+	}
+}
@@ -0,0 +1,120 @@
+#include "runner.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+
+using namespace std;
+
+/* This file contains the work-stealing task runner used by the experiments
+ */
+
+struct TaskQueue
+{
+	mutex lock;
+	deque<int> tasks;
+};
+
+int default_thread_count()
+{
+	int n = thread::hardware_concurrency();
+	return (n > 0) ? n : 1;
+}
+
+// Takes a task from the front of the own queue, or steals one from the back of another queue
+static int next_task(vector<unique_ptr<TaskQueue>> &queues, int self)
+{
+	int n = queues.size();
+	{
+		TaskQueue &own = *queues[self];
+		lock_guard<mutex> guard(own.lock);
+		if (!own.tasks.empty())
+		{
+			int t = own.tasks.front();
+			own.tasks.pop_front();
+			return t;
+		}
+	}
+
+	for (int k = 1; k < n; ++k)
+	{
+		TaskQueue &victim = *queues[(self + k) % n];
+		lock_guard<mutex> guard(victim.lock);
+		if (!victim.tasks.empty())
+		{
+			int t = victim.tasks.back();
+			victim.tasks.pop_back();
+			return t;
+		}
+	}
+
+	// No task is ever added, so every queue is empty for good
+	return -1;
+}
+
+void run_tasks(const vector<function<void()>> &tasks, int n_threads /*= 0*/)
+{
+	if (n_threads <= 0)
+		n_threads = default_thread_count();
+	n_threads = max(1, min(n_threads, (int)tasks.size()));
+
+	if (n_threads == 1)
+	{
+		for (auto &task : tasks)
+			task();
+		return;
+	}
+
+	vector<unique_ptr<TaskQueue>> queues;
+	for (int i = 0; i < n_threads; ++i)
+		queues.emplace_back(new TaskQueue());
+	for (size_t t = 0; t < tasks.size(); ++t)
+		queues[t % n_threads]->tasks.push_back(t);
+
+	vector<thread> workers;
+	for (int i = 0; i < n_threads; ++i)
+	{
+		workers.emplace_back([&, i]()
+		{
+			int t;
+			while ((t = next_task(queues, i)) != -1)
+				tasks[t]();
+		});
+	}
+
+	for (auto &w : workers)
+		w.join();
+}
+
+Barrier::Barrier(int n_threads) : n_threads(n_threads), waiting(0), generation(0)
+{
+}
+
+void Barrier::wait()
+{
+	unique_lock<mutex> guard(lock);
+	long arrived = generation;
+	if (++waiting == n_threads)
+	{
+		waiting = 0;
+		++generation;
+		released.notify_all();
+		return;
+	}
+	released.wait(guard, [&]() { return generation != arrived; });
+}
+
+void run_team(int n_threads, const function<void(int)> &body)
+{
+	if (n_threads <= 0)
+		n_threads = default_thread_count();
+
+	vector<thread> workers;
+	for (int i = 1; i < n_threads; ++i)
+		workers.emplace_back(body, i);
+	body(0);
+
+	for (auto &w : workers)
+		w.join();
+}
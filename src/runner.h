@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+/* Runs a list of independent tasks on a pool of threads, with work stealing.
+ *
+ * Each thread owns a deque of tasks, filled in round robin in the order of the list,
+ * so the first tasks of the list (e.g. the largest ones) are started first.
+ * A thread takes its next task at the front of its own deque and, when it is empty,
+ * steals from the back of the deque of another thread.
+ * Returns when all the tasks are done.
+ *
+ * @param tasks 		Tasks to run, in order of priority
+ * @param n_threads 	Number of threads, <= 0 for one per hardware thread
+ */
+void run_tasks(const std::vector<std::function<void()>> &tasks, int n_threads = 0);
+
+int default_thread_count();
+
+/* Barrier for a team of threads : wait() returns when all the threads of the team have called it.
+ * It can be used for any number of successive phases.
+ */
+class Barrier
+{
+private:
+	std::mutex lock;
+	std::condition_variable released;
+	int n_threads;
+	int waiting;
+	long generation;
+
+public:
+	Barrier(int n_threads);
+
+	void wait();
+};
+
+/* Runs body(id) for id = 0 .. n_threads - 1, each on its own thread (id 0 on the calling thread).
+ * Returns when all the calls have returned. The threads can synchronize with a Barrier.
+ *
+ * @param n_threads 	Number of threads, <= 0 for one per hardware thread
+ */
+void run_team(int n_threads, const std::function<void(int)> &body);
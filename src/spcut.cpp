@@ -0,0 +1,340 @@
+#include "pmaxcut.h"
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+/* This file contains the exact p-maxcut solver for series-parallel DAGs
+ */
+
+static const double NO_CUT = -numeric_limits<double>::infinity();
+
+/* Node of the decomposition tree.
+ * The table of a node contains the best weight of a cut of its component (the first
+ * terminal in S, the second one in T) for each number of red edges.
+ */
+struct SPNode
+{
+	enum Type {LEAF, SERIES, PARALLEL} type;
+	int left, right;		// children, or the edge id (-2 - index for a virtual edge) and its color for a leaf
+	size_t offset;			// choices of the node in the pool of choices
+};
+
+/* Series-parallel reduction of a two-terminal DAG
+ */
+class SPReduction
+{
+public:
+	vector<SPNode> nodes;
+	vector<vector<double>> tables;	// table of each node, freed once merged into its parent
+	vector<int> choices;			// series : child that contains the cut, parallel : number of red edges of the right child
+	int p_max;
+
+	// Arcs of the reduced graph
+	vector<int> arc_from, arc_to, arc_node;
+	vector<bool> arc_alive;
+	vector<vector<int>> out_arcs, in_arcs;	// lazy deletion of the dead arcs
+	vector<int> out_degree, in_degree;
+	unordered_map<uint64_t, int> arc_between;
+
+	SPReduction(int n, int p_max) : p_max(p_max), out_arcs(n), in_arcs(n), out_degree(n, 0), in_degree(n, 0) {}
+
+	int add_leaf(int edge_id, bool red, double weight)
+	{
+		vector<double> table(min(p_max, (int)red) + 1, NO_CUT);
+		if (red <= p_max)
+			table[red] = weight;
+		return add_node(SPNode::LEAF, edge_id, red, choices.size(), table);
+	}
+
+	int add_node(SPNode::Type type, int left, int right, size_t offset, vector<double> &table)
+	{
+		nodes.push_back({type, left, right, offset});
+		tables.emplace_back();
+		swap(tables.back(), table);
+		return nodes.size() - 1;
+	}
+
+	// The cut is in one of the two components : max of the tables
+	int series(int a, int b)
+	{
+		vector<double> &ta = tables[a], &tb = tables[b];
+		vector<double> table(max(ta.size(), tb.size()), NO_CUT);
+		size_t offset = choices.size();
+		choices.resize(offset + table.size(), -1);
+		for (size_t k = 0; k < table.size(); ++k)
+		{
+			if (k < ta.size() && ta[k] > table[k])
+			{
+				table[k] = ta[k];
+				choices[offset + k] = a;
+			}
+			if (k < tb.size() && tb[k] > table[k])
+			{
+				table[k] = tb[k];
+				choices[offset + k] = b;
+			}
+		}
+		vector<double>().swap(ta);
+		vector<double>().swap(tb);
+		return add_node(SPNode::SERIES, a, b, offset, table);
+	}
+
+	// The cut is the union of a cut of each component : (max,+) product of the tables
+	int parallel(int a, int b)
+	{
+		vector<double> &ta = tables[a], &tb = tables[b];
+		vector<double> table(min((size_t)p_max + 1, ta.size() + tb.size() - 1), NO_CUT);
+		size_t offset = choices.size();
+		choices.resize(offset + table.size(), -1);
+		for (size_t i = 0; i < ta.size(); ++i)
+		{
+			if (ta[i] == NO_CUT) continue;
+			for (size_t j = 0; j < tb.size() && i + j < table.size(); ++j)
+			{
+				if (tb[j] != NO_CUT && ta[i] + tb[j] > table[i + j])
+				{
+					table[i + j] = ta[i] + tb[j];
+					choices[offset + i + j] = j;
+				}
+			}
+		}
+		vector<double>().swap(ta);
+		vector<double>().swap(tb);
+		return add_node(SPNode::PARALLEL, a, b, offset, table);
+	}
+
+	// Adds an arc, merged with the arc between the same vertices if there is one
+	void add_arc(int from, int to, int node)
+	{
+		uint64_t key = ((uint64_t)from << 32) | (uint32_t)to;
+		auto it = arc_between.find(key);
+		if (it != arc_between.end())
+		{
+			int arc = it->second;
+			arc_node[arc] = parallel(arc_node[arc], node);
+			return;
+		}
+
+		arc_between[key] = arc_from.size();
+		out_arcs[from].push_back(arc_from.size());
+		in_arcs[to].push_back(arc_from.size());
+		arc_from.push_back(from);
+		arc_to.push_back(to);
+		arc_node.push_back(node);
+		arc_alive.push_back(true);
+		++out_degree[from];
+		++in_degree[to];
+	}
+
+	void remove_arc(int arc)
+	{
+		arc_alive[arc] = false;
+		--out_degree[arc_from[arc]];
+		--in_degree[arc_to[arc]];
+		arc_between.erase(((uint64_t)arc_from[arc] << 32) | (uint32_t)arc_to[arc]);
+	}
+
+	// First alive arc of a list, the dead arcs before it are removed
+	int first_alive(vector<int> &arcs)
+	{
+		size_t k = 0;
+		while (!arc_alive[arcs[k]])
+			++k;
+		arcs.erase(arcs.begin(), arcs.begin() + k);
+		return arcs[0];
+	}
+
+	/* Applies series reductions (and the parallel reductions that follow) until none is possible.
+	 * @return the root of the decomposition tree if the graph is reduced to one arc source -> target, -1 otherwise
+	 */
+	int reduce(int source, int target)
+	{
+		int n = out_arcs.size();
+		vector<int> todo;
+		for (int v = n - 1; v >= 0; --v)
+			todo.push_back(v);
+
+		while (!todo.empty())
+		{
+			int v = todo.back();
+			todo.pop_back();
+			if (v == source || v == target || in_degree[v] != 1 || out_degree[v] != 1) continue;
+
+			int a = first_alive(in_arcs[v]), b = first_alive(out_arcs[v]);
+			int u = arc_from[a], w = arc_to[b];
+			int node = series(arc_node[a], arc_node[b]);
+			remove_arc(a);
+			remove_arc(b);
+			add_arc(u, w, node);
+			todo.push_back(u);
+			todo.push_back(w);
+		}
+
+		if (arc_between.size() != 1) return -1;
+		auto it = arc_between.find(((uint64_t)source << 32) | (uint32_t)target);
+		return (it == arc_between.end()) ? -1 : arc_node[it->second];
+	}
+};
+
+/**
+ * @private
+ *  Compute the integral p-maximum topological cut of a series-parallel DAG, for all the
+ *  values of p up to p_max at once.
+ *
+ *  The vertices without predecessor (resp. successor) are linked to the source (resp. from
+ *  the target) by virtual edges of null weight, which don't constrain the cut. The graph is
+ *  then reduced by series reductions (a vertex with one incoming and one outgoing edge) and
+ *  parallel reductions (edges between the same vertices). It is series-parallel iff it is
+ *  reduced to one edge source -> target.
+ *  Each node of the decomposition tree has a table of the best weight of its cuts for each
+ *  number of red edges (at most p_max) : the cut of a series composition is in one of the
+ *  components (max of the tables), the cut of a parallel composition is the union of a cut
+ *  of each component ((max,+) product of the tables). The choices are kept to rebuild the cut.
+ *
+ *  Graphs that are not series-parallel are not contracted : the caller must use another solver.
+ *
+ * @param graph		the DAG in Graph format
+ * @param p_max		value of p
+ * @param cut 		vector that will contain the edges of the cut
+ * @param S 		vector that will contain the S set after the cut
+ * @param T			vector that will contain the T set after the cut
+ * @param res 		double where the p-max cut value will be stored
+ * @param values	if not null, will contain the value of the p-maxcut for p = 0..p_max
+ * 					(-1 if no cut has at most p red edges)
+ *
+ *
+ * @return 0 if everything went well, 2 if no cut has at most p_max red edges, 3 if the source
+ *  or the target are not set, 4 if the graph is not series-parallel.
+ */
+int get_p_maxcut_sp(const Graph &graph, int p_max,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res, vector<double> *values)
+{
+	int source = graph.source_id, target = graph.target_id;
+	if (source == -1 || target == -1) return 3;
+
+	cut.clear();
+	S.clear();
+	T.clear();
+	res = -1;
+	if (values)
+		values->assign(p_max + 1, -1);
+
+	int n = graph.n_vertices();
+	SPReduction sp(n, p_max);
+	vector<int> has_in(n, 0), has_out(n, 0);
+	for (auto e : graph.edges)
+	{
+		sp.add_arc(e->id_from, e->id_to, sp.add_leaf(e->id, e->red, e->weight));
+		has_out[e->id_from] = has_in[e->id_to] = 1;
+	}
+
+	// Virtual edges
+	vector<pair<int,int>> virtual_edges;
+	for (int v = 0; v < n; ++v)
+	{
+		if (v != source && !has_in[v])
+			virtual_edges.push_back(make_pair(source, v));
+		if (v != target && !has_out[v])
+			virtual_edges.push_back(make_pair(v, target));
+	}
+	for (size_t k = 0; k < virtual_edges.size(); ++k)
+		sp.add_arc(virtual_edges[k].first, virtual_edges[k].second, sp.add_leaf(-2 - k, false, 0));
+
+	int root = sp.reduce(source, target);
+	if (root == -1) return 4;
+
+	const vector<double> &table = sp.tables[root];
+	int best = -1;
+	for (int k = 0; k < (int)table.size(); ++k)
+	{
+		if (table[k] != NO_CUT && (best == -1 || table[k] > table[best]))
+			best = k;
+		if (values && best != -1)
+			(*values)[k] = table[best];
+	}
+	if (values && best != -1)
+	{
+		for (int k = table.size(); k <= p_max; ++k)
+			(*values)[k] = table[best];
+	}
+	if (best == -1) return 2;
+
+	// Edges of the best cut, from the choices
+	vector<bool> in_cut(graph.n_edges(), false), virtual_in_cut(virtual_edges.size(), false);
+	vector<pair<int,int>> todo(1, make_pair(root, best));
+	while (!todo.empty())
+	{
+		int node = todo.back().first, k = todo.back().second;
+		todo.pop_back();
+		const SPNode &x = sp.nodes[node];
+		if (x.type == SPNode::LEAF)
+		{
+			if (x.left >= 0)
+				in_cut[x.left] = true;
+			else
+				virtual_in_cut[-2 - x.left] = true;
+		}
+		else if (x.type == SPNode::SERIES)
+		{
+			todo.push_back(make_pair(sp.choices[x.offset + k], k));
+		}
+		else
+		{
+			int j = sp.choices[x.offset + k];
+			todo.push_back(make_pair(x.left, k - j));
+			todo.push_back(make_pair(x.right, j));
+		}
+	}
+
+	// S : vertices reachable from the source without crossing the cut
+	vector<vector<int>> succ(n);
+	for (auto e : graph.edges)
+	{
+		if (!in_cut[e->id])
+			succ[e->id_from].push_back(e->id_to);
+	}
+	for (size_t k = 0; k < virtual_edges.size(); ++k)
+	{
+		if (!virtual_in_cut[k])
+			succ[virtual_edges[k].first].push_back(virtual_edges[k].second);
+	}
+	vector<bool> in_S(n, false);
+	vector<int> stack(1, source);
+	in_S[source] = true;
+	while (!stack.empty())
+	{
+		int v = stack.back();
+		stack.pop_back();
+		for (int w : succ[v])
+		{
+			if (!in_S[w])
+			{
+				in_S[w] = true;
+				stack.push_back(w);
+			}
+		}
+	}
+
+	res = 0;
+	for (auto e : graph.edges)
+	{
+		if (in_S[e->id_from] && !in_S[e->id_to])
+		{
+			res += e->weight;
+			cut.push_back(e->id);
+		}
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		if (in_S[i])
+			S.push_back(i);
+		else
+			T.push_back(i);
+	}
+
+	return 0;
+}
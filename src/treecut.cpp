@@ -0,0 +1,260 @@
+#include "pmaxcut.h"
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+/* This file contains the exact p-maxcut solver for forests (e.g. assembly trees)
+ */
+
+static const double NO_CUT = -numeric_limits<double>::infinity();
+
+// (max,+) product of two tables, truncated to p_max + 1 entries.
+// The index taken in b for each entry of the result is appended to splits.
+static void merge_tables(const vector<double> &a, const vector<double> &b, int p_max,
+		vector<double> &res, vector<int> &splits)
+{
+	int size = min(p_max + 1, (int)(a.size() + b.size()) - 1);
+	res.assign(size, NO_CUT);
+	size_t offset = splits.size();
+	splits.resize(offset + size, -1);
+	int *split = &splits[offset];
+
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		if (a[i] == NO_CUT) continue;
+		for (size_t j = 0; j < b.size() && (int)(i + j) < size; ++j)
+		{
+			if (b[j] == NO_CUT) continue;
+			if (a[i] + b[j] > res[i + j])
+			{
+				res[i + j] = a[i] + b[j];
+				split[i + j] = j;
+			}
+		}
+	}
+}
+
+/**
+ * @private
+ *  Compute the integral p-maximum topological cut of a DAG that is a forest, for all the
+ *  values of p up to p_max at once.
+ *
+ *  The edges that don't constrain the cut are ignored : edges of null weight that are not red
+ *  and leave the source or enter the target (e.g. added by make_single_source_target).
+ *  If every vertex then has at most one outgoing edge (in-forest, such as an assembly tree
+ *  after convert_to_SimpleDataFlow), S is a union of disjoint subtrees and the cut is made of
+ *  the edges leaving their roots. An out-forest is solved as the in-forest of the reversed
+ *  graph, whose S is the T of the original graph.
+ *
+ *  A bottom-up dynamic program computes, for each vertex, the best weight of the cut of its
+ *  subtree for each number of red edges (at most p_max) : either the whole subtree is in S,
+ *  or the tables of the children are merged by (max,+) product. The splits of the products
+ *  are kept to rebuild the cut. O(n p_max) time and memory.
+ *
+ * @param graph		the DAG in Graph format
+ * @param p_max		value of p
+ * @param cut 		vector that will contain the edges of the cut
+ * @param S 		vector that will contain the S set after the cut
+ * @param T			vector that will contain the T set after the cut
+ * @param res 		double where the p-max cut value will be stored
+ * @param values	if not null, will contain the value of the p-maxcut for p = 0..p_max
+ * 					(-1 if no cut has at most p red edges)
+ *
+ *
+ * @return 0 if everything went well, 2 if no cut has at most p_max red edges, 3 if the source
+ *  or the target are not set, 4 if the graph is not a forest.
+ */
+int get_p_maxcut_tree(const Graph &graph, int p_max,
+		vector<int> &cut, vector<int> &S, vector<int> &T, double &res, vector<double> *values)
+{
+	int source = graph.source_id, target = graph.target_id;
+	if (source == -1 || target == -1) return 3;
+
+	cut.clear();
+	S.clear();
+	T.clear();
+	res = -1;
+	if (values)
+		values->assign(p_max + 1, -1);
+
+	int n = graph.n_vertices();
+	vector<bool> kept(graph.n_edges(), false);
+	vector<int> out_degree(n, 0), in_degree(n, 0);
+	bool in_forest = true, out_forest = true;
+	for (auto e : graph.edges)
+	{
+		if (e->weight == 0 && !e->red && (e->id_from == source || e->id_to == target))
+			continue;
+		kept[e->id] = true;
+		in_forest = in_forest && ++out_degree[e->id_from] <= 1;
+		out_forest = out_forest && ++in_degree[e->id_to] <= 1;
+	}
+	if (!in_forest && !out_forest) return 4;
+
+	// Forest oriented towards the roots : in_S must be in the selection, out_S must not
+	int in_S = (in_forest) ? source : target;
+	int out_S = (in_forest) ? target : source;
+	vector<Edge*> parent_edge(n, nullptr);
+	vector<int> parent(n, -1);
+	vector<int> first_child(n + 1, 0), children(n);
+	for (auto e : graph.edges)
+	{
+		if (!kept[e->id]) continue;
+		int child = (in_forest) ? e->id_from : e->id_to;
+		parent[child] = (in_forest) ? e->id_to : e->id_from;
+		parent_edge[child] = e;
+		++first_child[parent[child] + 1];
+	}
+	for (int v = 0; v < n; ++v)
+		first_child[v + 1] += first_child[v];
+	vector<int> fill(first_child.begin(), first_child.end() - 1);
+	for (int v = 0; v < n; ++v)
+	{
+		if (parent[v] != -1)
+			children[fill[parent[v]]++] = v;
+	}
+
+	// Post order, roots last
+	vector<int> order, stack;
+	order.reserve(n);
+	for (int r = 0; r < n; ++r)
+	{
+		if (parent[r] != -1) continue;
+		stack.push_back(r);
+		while (!stack.empty())
+		{
+			int v = stack.back();
+			stack.pop_back();
+			order.push_back(v);
+			for (int c = first_child[v]; c < first_child[v + 1]; ++c)
+				stack.push_back(children[c]);
+		}
+	}
+	if ((int)order.size() != n) return 4; // not acyclic
+	reverse(order.begin(), order.end());
+
+	// Bottom-up dynamic program
+	vector<vector<double>> table(n);
+	vector<bool> contains_out(n, false);
+	vector<bool> whole_wins(n, false);		// the best cut at the red count of the parent edge is the whole subtree
+	vector<size_t> merge_offset(n);			// splits of the merge of the table of v into the table of its parent
+	vector<int> splits;
+	for (int v : order)
+	{
+		vector<double> acc(1, (v == in_S) ? NO_CUT : 0), tmp;
+		contains_out[v] = (v == out_S);
+		for (int c = first_child[v]; c < first_child[v + 1]; ++c)
+		{
+			int child = children[c];
+			contains_out[v] = contains_out[v] || contains_out[child];
+			merge_offset[child] = splits.size();
+			merge_tables(acc, table[child], p_max, tmp, splits);
+			swap(acc, tmp);
+			vector<double>().swap(table[child]);
+		}
+
+		// The whole subtree in S : the parent edge (if any) is cut
+		if (!contains_out[v])
+		{
+			Edge *e = parent_edge[v];
+			int red = (e && e->red) ? 1 : 0;
+			double weight = (e) ? e->weight : 0;
+			if (red <= p_max)
+			{
+				if ((int)acc.size() <= red)
+					acc.resize(red + 1, NO_CUT);
+				if (weight > acc[red])
+				{
+					acc[red] = weight;
+					whole_wins[v] = true;
+				}
+			}
+		}
+		swap(table[v], acc);
+	}
+
+	// Merge the trees of the forest
+	vector<int> roots;
+	vector<double> forest(1, 0), tmp;
+	for (int v : order)
+	{
+		if (parent[v] != -1) continue;
+		roots.push_back(v);
+		merge_offset[v] = splits.size();
+		merge_tables(forest, table[v], p_max, tmp, splits);
+		swap(forest, tmp);
+	}
+
+	int best = -1;
+	for (int k = 0; k < (int)forest.size(); ++k)
+	{
+		if (forest[k] != NO_CUT && (best == -1 || forest[k] > forest[best]))
+			best = k;
+		if (values && best != -1)
+			(*values)[k] = forest[best];
+	}
+	if (values && best != -1)
+	{
+		for (int k = forest.size(); k <= p_max; ++k)
+			(*values)[k] = forest[best];
+	}
+	if (best == -1) return 2;
+
+	// Rebuild the selected subtrees from the splits
+	vector<bool> selected(n, false);
+	vector<pair<int,int>> todo;
+	for (int i = roots.size() - 1, k = best; i >= 0; --i)
+	{
+		int j = splits[merge_offset[roots[i]] + k];
+		todo.push_back(make_pair(roots[i], j));
+		k -= j;
+	}
+	while (!todo.empty())
+	{
+		int v = todo.back().first, k = todo.back().second;
+		todo.pop_back();
+		Edge *e = parent_edge[v];
+		if (whole_wins[v] && k == ((e && e->red) ? 1 : 0))
+		{
+			selected[v] = true;
+			continue;
+		}
+		for (int c = first_child[v + 1] - 1; c >= first_child[v]; --c)
+		{
+			int j = splits[merge_offset[children[c]] + k];
+			todo.push_back(make_pair(children[c], j));
+			k -= j;
+		}
+	}
+
+	// S is the union of the selected subtrees (T for an out-forest)
+	vector<bool> in_cut_side(n, false);
+	for (int i = n - 1; i >= 0; --i)
+	{
+		int v = order[i];
+		in_cut_side[v] = selected[v] || (parent[v] != -1 && in_cut_side[parent[v]]);
+	}
+	if (!in_forest)
+		in_cut_side.flip();
+
+	res = 0;
+	for (auto e : graph.edges)
+	{
+		if (in_cut_side[e->id_from] && !in_cut_side[e->id_to])
+		{
+			res += e->weight;
+			cut.push_back(e->id);
+		}
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		if (in_cut_side[i])
+			S.push_back(i);
+		else
+			T.push_back(i);
+	}
+
+	return 0;
+}